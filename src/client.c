@@ -95,6 +95,7 @@ help_and_exit(int exit_code)
 	COMMAND("rename <station> <name>", "Rename a station");
 	COMMAND("move   <station> [[first/last] [before/after <station>]]", "");
 	DESC   ("Move a station in the list");
+	COMMAND("import <playlist-file>", "Add the stations of a playlist file");
 	NL();
 
 	TITLE  ("Configuration");
@@ -330,6 +331,31 @@ parse_move_args(int argc, char *argv[], GVariantBuilder *b)
 	return 0;
 }
 
+int
+parse_import_args(int argc, char *argv[], GVariantBuilder *b)
+{
+	gchar *path;
+
+	if (argc != 1)
+		return -1;
+
+	/* The server doesn't run in our working directory */
+	if (g_path_is_absolute(argv[0])) {
+		path = g_strdup(argv[0]);
+	} else {
+		gchar *cwd;
+
+		cwd = g_get_current_dir();
+		path = g_build_filename(cwd, argv[0], NULL);
+		g_free(cwd);
+	}
+
+	g_variant_builder_add(b, "s", path);
+	g_free(path);
+
+	return 0;
+}
+
 int
 parse_boolean(int argc, char *argv[], GVariantBuilder *b)
 {
@@ -497,6 +523,16 @@ print_list_result(GVariant *result)
 	g_variant_iter_free(iter1);
 }
 
+void
+print_import_result(GVariant *result)
+{
+	guint n_imported;
+	guint n_duplicates;
+
+	g_variant_get(result, "(uu)", &n_imported, &n_duplicates);
+	print("%u stations imported, %u duplicates skipped", n_imported, n_duplicates);
+}
+
 struct cmd root_cmds[] = {
 	{ METHOD, "quit", "Quit", NULL, NULL },
 	{ METHOD, NULL,   NULL,   NULL, NULL }
@@ -519,12 +555,13 @@ struct cmd player_cmds[] = {
 };
 
 struct cmd stations_cmds[] = {
-	{ METHOD,   "list",    "List",   NULL,              print_list_result },
-	{ METHOD,   "add",     "Add",    parse_add_args,    NULL              },
-	{ METHOD,   "remove",  "Remove", parse_remove_args, NULL              },
-	{ METHOD,   "rename",  "Rename", parse_rename_args, NULL              },
-	{ METHOD,   "move",    "Move",   parse_move_args,   NULL              },
-	{ METHOD,   NULL,      NULL,     NULL,              NULL              }
+	{ METHOD,   "list",    "List",   NULL,              print_list_result   },
+	{ METHOD,   "add",     "Add",    parse_add_args,    NULL                },
+	{ METHOD,   "remove",  "Remove", parse_remove_args, NULL                },
+	{ METHOD,   "rename",  "Rename", parse_rename_args, NULL                },
+	{ METHOD,   "move",    "Move",   parse_move_args,   NULL                },
+	{ METHOD,   "import",  "Import", parse_import_args, print_import_result },
+	{ METHOD,   NULL,      NULL,     NULL,              NULL                }
 };
 
 struct interface interfaces[] = {
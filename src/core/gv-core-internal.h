@@ -27,6 +27,7 @@
 #define __GOODVIBES_CORE_GV_CORE_INTERNAL_H__
 
 #include <gio/gio.h>
+#include <libsoup/soup.h>
 
 /* Global variables */
 
@@ -34,4 +35,6 @@ extern GSettings   *gv_core_settings;
 
 extern const gchar *gv_core_user_agent;
 
+extern SoupSession *gv_core_soup_session;
+
 #endif /* __GOODVIBES_CORE_GV_CORE_INTERNAL_H__ */
@@ -21,11 +21,14 @@
 
 #include <glib.h>
 #include <gio/gio.h>
+#include <libsoup/soup.h>
 
 #include "framework/gv-framework.h"
 
 #include "core/gv-engine.h"
 #include "core/gv-player.h"
+#include "core/gv-playlist.h"
+#include "core/gv-resolver.h"
 #include "core/gv-station-list.h"
 
 /*
@@ -40,11 +43,14 @@ GvPlayer      *gv_core_player;
 
 gchar         *gv_core_user_agent;
 
+SoupSession   *gv_core_soup_session;
+
 /*
  * Private variables
  */
 
-static GvEngine *gv_core_engine;
+static GvEngine   *gv_core_engine;
+static GvResolver *gv_core_resolver;
 
 static GList *core_objects;
 
@@ -85,6 +91,21 @@ gv_core_audio_backend_compile_version_string(void)
  * Helpers
  */
 
+#define MAX_CONNS          16
+#define MAX_CONNS_PER_HOST 2
+
+static SoupSession *
+make_soup_session(void)
+{
+	/* One session for the whole process, so that connections are
+	 * kept alive and reused across playlist downloads.
+	 */
+	return soup_session_new_with_options(SOUP_SESSION_USER_AGENT, gv_core_user_agent,
+	                                     SOUP_SESSION_MAX_CONNS, MAX_CONNS,
+	                                     SOUP_SESSION_MAX_CONNS_PER_HOST, MAX_CONNS_PER_HOST,
+	                                     NULL);
+}
+
 static gchar *
 make_user_agent(void)
 {
@@ -136,6 +157,13 @@ gv_core_cleanup(void)
 	/* Clear application pointer */
 	gv_core_application = NULL;
 
+	/* Write what's left to write */
+	gv_playlist_flush_cache();
+
+	/* Destroy http session */
+	soup_session_abort(gv_core_soup_session);
+	g_clear_object(&gv_core_soup_session);
+
 	/* Free strings */
 	g_free(gv_core_user_agent);
 }
@@ -156,6 +184,10 @@ gv_core_init(GApplication *application)
 	gv_core_settings = g_settings_new(PACKAGE_APPLICATION_ID ".Core");
 	core_objects = g_list_append(core_objects, gv_core_settings);
 
+	gv_core_soup_session = make_soup_session();
+	g_settings_bind(gv_core_settings, "playlist-timeout",
+	                gv_core_soup_session, "timeout", G_SETTINGS_BIND_GET);
+
 	gv_core_station_list = gv_station_list_new();
 	core_objects = g_list_append(core_objects, gv_core_station_list);
 
@@ -165,6 +197,9 @@ gv_core_init(GApplication *application)
 	gv_core_player = gv_player_new(gv_core_engine, gv_core_station_list);
 	core_objects = g_list_append(core_objects, gv_core_player);
 
+	gv_core_resolver = gv_resolver_new(gv_core_player, gv_core_station_list);
+	core_objects = g_list_append(core_objects, gv_core_resolver);
+
 	/* Register objects in the framework */
 	for (item = core_objects; item; item = item->next) {
 		GObject *object = G_OBJECT(item->data);
@@ -46,6 +46,62 @@
 #define DEFAULT_VOLUME 100
 #define DEFAULT_MUTE   FALSE
 
+/*
+ * Failover
+ */
+
+/* Delay after which a stream that doesn't start playing, and doesn't make
+ * any buffering progress, is considered as stalled. We then fail over to
+ * the next stream uri of the station.
+ */
+#define STALL_TIMEOUT 10 // seconds
+
+/*
+ * Standby
+ */
+
+/* Maximum number of pipelines that are kept prebuffered */
+#define MAX_STANDBY_STATIONS 4
+
+/* A paused pipeline holds audio that gets older, and its connection is
+ * likely to be dropped by the server. So it's reconnected after a while.
+ */
+#define STANDBY_MAX_AGE        20 // seconds
+#define STANDBY_CHECK_INTERVAL 5  // seconds
+
+/* Maximum number of stream uris that are connected to at once */
+#define MAX_RACE_STREAMS 4
+
+/*
+ * Reconnect
+ */
+
+/* Delay before reconnecting, doubled after each failed attempt */
+#define RECONNECT_DELAY_MIN 1000  // milliseconds
+#define RECONNECT_DELAY_MAX 60000 // milliseconds
+
+/* Consecutive failed attempts after which the circuit breaker opens. We
+ * then wait for the cooldown, and probe with a single attempt, until one
+ * of them succeeds.
+ */
+#define RECONNECT_MAX_TRIES 10
+#define RECONNECT_COOLDOWN  300 // seconds
+
+/*
+ * Adaptive buffering
+ */
+
+/* The buffer holds that many times the longest gap between two arrivals
+ * of data, within some bounds.
+ */
+#define ADAPTIVE_FACTOR       4
+#define ADAPTIVE_DURATION_MIN 500   // milliseconds
+#define ADAPTIVE_DURATION_MAX 10000 // milliseconds
+
+/* Used when the watermarks from the settings don't make sense */
+#define DEFAULT_LOW_WATERMARK  10
+#define DEFAULT_HIGH_WATERMARK 99
+
 enum {
 	/* Reserved */
 	PROP_0,
@@ -58,6 +114,8 @@ enum {
 	PROP_MUTE,
 	PROP_PIPELINE_ENABLED,
 	PROP_PIPELINE_STRING,
+	PROP_RECONNECT_COUNT,
+	PROP_DOWNTIME,
 	/* Number of properties */
 	PROP_N
 };
@@ -68,6 +126,25 @@ static GParamSpec *properties[PROP_N];
  * GObject definitions
  */
 
+/* Data arrival measure, shared between a pipeline and its source probe */
+typedef struct {
+	gint    ref_count;
+	gchar  *station_uri;
+	gint    jitter;
+	gint64  last_arrival;
+} GvEngineMeter;
+
+typedef struct {
+	GvStation     *station;
+	gchar         *stream_uri;
+	GstElement    *playbin;
+	GstBus        *bus;
+	gboolean       buffered;
+	gboolean       racing;
+	gint64         start_time;
+	GvEngineMeter *meter;
+} GvEngineStandby;
+
 struct _GvEnginePrivate {
 	/* GStreamer stuff */
 	GstElement    *playbin;
@@ -81,6 +158,29 @@ struct _GvEnginePrivate {
 	gboolean       mute;
 	gboolean       pipeline_enabled;
 	gchar         *pipeline_string;
+	/* Failover */
+	gchar         *stream_uri;
+	guint          n_stream_tries;
+	guint          stall_source_id;
+	gint           stall_percent;
+	/* Prebuffered pipelines */
+	GList         *standbys;
+	guint          standby_source_id;
+	/* Pipelines racing against the current one */
+	GList         *racers;
+	/* Reconnect */
+	guint          reconnect_source_id;
+	guint          n_reconnect_tries;
+	guint          reconnect_count;
+	guint          downtime;
+	gint64         down_since;
+	/* Time of the last play request, to measure switch latency */
+	gint64         play_time;
+	/* Buffering */
+	guint          low_watermark;
+	guint          high_watermark;
+	GHashTable    *jitters;
+	GvEngineMeter *meter;
 };
 
 typedef struct _GvEnginePrivate GvEnginePrivate;
@@ -128,6 +228,31 @@ set_gst_state(GstElement *playbin, GstState state)
 	}
 }
 
+static gboolean
+is_error_transient(GError *error)
+{
+	/* Network troubles, but not a wrong uri */
+	if (error->domain != GST_RESOURCE_ERROR)
+		return FALSE;
+
+	switch (error->code) {
+	case GST_RESOURCE_ERROR_NOT_FOUND:
+	case GST_RESOURCE_ERROR_NOT_AUTHORIZED:
+		return FALSE;
+	default:
+		return TRUE;
+	}
+}
+
+static GstElement *
+make_audio_sink(gboolean pipeline_enabled, const gchar *pipeline_string, GError **err)
+{
+	if (pipeline_enabled == FALSE || pipeline_string == NULL)
+		return NULL;
+
+	return gst_parse_launch(pipeline_string, err);
+}
+
 #if 0
 static GstState
 get_gst_state(GstElement *playbin)
@@ -243,6 +368,7 @@ gv_engine_reload_pipeline(GvEngine *self)
 	const gchar *pipeline_string = priv->pipeline_string;
 	GstElement *cur_audio_sink = NULL;
 	GstElement *new_audio_sink = NULL;
+	GError *err = NULL;
 
 	g_return_if_fail(playbin != NULL);
 
@@ -253,19 +379,13 @@ gv_engine_reload_pipeline(GvEngine *self)
 	      "null (default)");
 
 	/* Create a new audio sink */
-	if (pipeline_enabled == FALSE || pipeline_string == NULL) {
-		new_audio_sink = NULL;
-	} else {
-		GError *err = NULL;
-
-		new_audio_sink = gst_parse_launch(pipeline_string, &err);
-		if (err) {
-			WARNING("Failed to parse pipeline description: %s", err->message);
-			gv_errorable_emit_error(GV_ERRORABLE(self), _("%s: %s"),
-			                        _("Failed to parse pipeline description"),
-			                        err->message);
-			g_error_free(err);
-		}
+	new_audio_sink = make_audio_sink(pipeline_enabled, pipeline_string, &err);
+	if (err) {
+		WARNING("Failed to parse pipeline description: %s", err->message);
+		gv_errorable_emit_error(GV_ERRORABLE(self), _("%s: %s"),
+		                        _("Failed to parse pipeline description"),
+		                        err->message);
+		g_error_free(err);
 	}
 
 	DEBUG("New audio sink: %s", new_audio_sink ? GST_ELEMENT_NAME(new_audio_sink) :
@@ -275,6 +395,9 @@ gv_engine_reload_pipeline(GvEngine *self)
 	if (cur_audio_sink != new_audio_sink) {
 		gv_engine_stop(self);
 
+		/* Prebuffered pipelines have the old sink */
+		gv_engine_set_standby_stations(self, NULL);
+
 		if (new_audio_sink == NULL)
 			INFO("Setting gst audio sink to default");
 		else
@@ -438,6 +561,18 @@ gv_engine_get_pipeline_string(GvEngine *self)
 	return self->priv->pipeline_string;
 }
 
+guint
+gv_engine_get_reconnect_count(GvEngine *self)
+{
+	return self->priv->reconnect_count;
+}
+
+guint
+gv_engine_get_downtime(GvEngine *self)
+{
+	return self->priv->downtime;
+}
+
 void
 gv_engine_set_pipeline_string(GvEngine *self, const gchar *pipeline_string)
 {
@@ -463,68 +598,699 @@ gv_engine_get_property(GObject    *object,
                        GValue     *value,
                        GParamSpec *pspec)
 {
-	GvEngine *self = GV_ENGINE(object);
+	GvEngine *self = GV_ENGINE(object);
+
+	TRACE_GET_PROPERTY(object, property_id, value, pspec);
+
+	switch (property_id) {
+	case PROP_STATE:
+		g_value_set_enum(value, gv_engine_get_state(self));
+		break;
+	case PROP_BITRATE:
+		g_value_set_uint(value, gv_engine_get_bitrate(self));
+		break;
+	case PROP_STATION:
+		g_value_set_object(value, gv_engine_get_station(self));
+		break;
+	case PROP_METADATA:
+		g_value_set_object(value, gv_engine_get_metadata(self));
+		break;
+	case PROP_VOLUME:
+		g_value_set_uint(value, gv_engine_get_volume(self));
+		break;
+	case PROP_MUTE:
+		g_value_set_boolean(value, gv_engine_get_mute(self));
+		break;
+	case PROP_PIPELINE_ENABLED:
+		g_value_set_boolean(value, gv_engine_get_pipeline_enabled(self));
+		break;
+	case PROP_PIPELINE_STRING:
+		g_value_set_string(value, gv_engine_get_pipeline_string(self));
+		break;
+	case PROP_RECONNECT_COUNT:
+		g_value_set_uint(value, gv_engine_get_reconnect_count(self));
+		break;
+	case PROP_DOWNTIME:
+		g_value_set_uint(value, gv_engine_get_downtime(self));
+		break;
+	default:
+		G_OBJECT_WARN_INVALID_PROPERTY_ID(object, property_id, pspec);
+		break;
+	}
+}
+
+static void
+gv_engine_set_property(GObject      *object,
+                       guint         property_id,
+                       const GValue *value,
+                       GParamSpec   *pspec)
+{
+	GvEngine *self = GV_ENGINE(object);
+
+	TRACE_SET_PROPERTY(object, property_id, value, pspec);
+
+	switch (property_id) {
+	case PROP_VOLUME:
+		gv_engine_set_volume(self, g_value_get_uint(value));
+		break;
+	case PROP_MUTE:
+		gv_engine_set_mute(self, g_value_get_boolean(value));
+		break;
+	case PROP_PIPELINE_ENABLED:
+		gv_engine_set_pipeline_enabled(self, g_value_get_boolean(value));
+		break;
+	case PROP_PIPELINE_STRING:
+		gv_engine_set_pipeline_string(self, g_value_get_string(value));
+		break;
+	default:
+		G_OBJECT_WARN_INVALID_PROPERTY_ID(object, property_id, pspec);
+		break;
+	}
+}
+
+/*
+ * Failover
+ */
+
+static void gv_engine_play_stream(GvEngine *self, const gchar *stream_uri);
+static void gv_engine_play_standby(GvEngine *self, GvEngineStandby *standby);
+static void gv_engine_save_jitter(GvEngine *self);
+static void gv_engine_meter_unref(GvEngineMeter *meter);
+static void gv_engine_setup_buffering(GvEngine *self, GstElement *playbin,
+                                      GvStation *station);
+static void gv_engine_stop_race(GvEngine *self);
+static void gv_engine_stop_reconnect(GvEngine *self);
+static gboolean gv_engine_schedule_reconnect(GvEngine *self);
+static gboolean when_timeout_stream_stalled(GvEngine *self);
+
+static void
+gv_engine_stop_stall_watch(GvEngine *self)
+{
+	GvEnginePrivate *priv = self->priv;
+
+	if (priv->stall_source_id) {
+		g_source_remove(priv->stall_source_id);
+		priv->stall_source_id = 0;
+	}
+}
+
+static void
+gv_engine_start_stall_watch(GvEngine *self)
+{
+	GvEnginePrivate *priv = self->priv;
+
+	gv_engine_stop_stall_watch(self);
+	priv->stall_percent = -1;
+	priv->stall_source_id = g_timeout_add_seconds
+	                        (STALL_TIMEOUT, (GSourceFunc) when_timeout_stream_stalled, self);
+}
+
+static gboolean
+gv_engine_failover(GvEngine *self)
+{
+	GvEnginePrivate *priv = self->priv;
+	GvStation *station = priv->station;
+	GSList *stream_uris;
+	GSList *item;
+	const gchar *next_uri;
+
+	if (station == NULL || priv->state == GV_ENGINE_STATE_STOPPED)
+		return FALSE;
+
+	/* A racing stream is already connecting, take it */
+	if (priv->racers) {
+		GvEngineStandby *racer = priv->racers->data;
+
+		INFO("Stream '%s' failed, failing over to '%s'", priv->stream_uri,
+		     racer->stream_uri);
+		gv_engine_play_standby(self, racer);
+		return TRUE;
+	}
+
+	/* Give up when every stream was tried */
+	stream_uris = gv_station_get_stream_uris(station);
+	if (priv->n_stream_tries >= g_slist_length(stream_uris))
+		return FALSE;
+
+	/* Pick the stream after the current one, wrapping around */
+	item = g_slist_find_custom(stream_uris, priv->stream_uri, (GCompareFunc) g_strcmp0);
+	if (item && item->next)
+		next_uri = item->next->data;
+	else
+		next_uri = stream_uris->data;
+
+	INFO("Stream '%s' failed, failing over to '%s'", priv->stream_uri, next_uri);
+
+	priv->n_stream_tries++;
+	gv_engine_play_stream(self, next_uri);
+
+	return TRUE;
+}
+
+static gboolean
+when_timeout_stream_stalled(GvEngine *self)
+{
+	GvEnginePrivate *priv = self->priv;
+
+	priv->stall_source_id = 0;
+
+	if (priv->state != GV_ENGINE_STATE_CONNECTING &&
+	    priv->state != GV_ENGINE_STATE_BUFFERING)
+		return G_SOURCE_REMOVE;
+
+	/* If there's no other stream to try, reconnect later */
+	DEBUG("Stream '%s' stalled", priv->stream_uri);
+	if (gv_engine_failover(self) == FALSE &&
+	    gv_engine_schedule_reconnect(self) == FALSE)
+		gv_errorable_emit_error(GV_ERRORABLE(self), "%s", _("Stream stalled"));
+
+	return G_SOURCE_REMOVE;
+}
+
+static void
+gv_engine_start_playback(GvEngine *self)
+{
+	GvEnginePrivate *priv = self->priv;
+
+	set_gst_state(priv->playbin, GST_STATE_PLAYING);
+	gv_engine_set_state(self, GV_ENGINE_STATE_PLAYING);
+
+	if (priv->play_time) {
+		gint64 elapsed = g_get_monotonic_time() - priv->play_time;
+
+		DEBUG("Playback started %" G_GINT64_FORMAT " ms after the play request",
+		      elapsed / 1000);
+		priv->play_time = 0;
+	}
+
+	/* This stream works, try it first next time */
+	gv_engine_stop_stall_watch(self);
+	gv_engine_stop_race(self);
+	gv_engine_stop_reconnect(self);
+	priv->n_stream_tries = 1;
+	priv->n_reconnect_tries = 0;
+	if (priv->station)
+		gv_station_set_preferred_stream_uri(priv->station, priv->stream_uri);
+}
+
+static void
+gv_engine_play_stream(GvEngine *self, const gchar *stream_uri)
+{
+	GvEnginePrivate *priv = self->priv;
+
+	/* Remember the stream uri */
+	if (priv->stream_uri != stream_uri) {
+		g_free(priv->stream_uri);
+		priv->stream_uri = g_strdup(stream_uri);
+	}
+
+	/* According to the doc:
+	 *
+	 * > State changes to GST_STATE_READY or GST_STATE_NULL never return
+	 * > GST_STATE_CHANGE_ASYNC.
+	 *
+	 * https://gstreamer.freedesktop.org/data/doc/gstreamer/head/gstreamer/html/
+	 * GstElement.html#gst-element-set-state
+	 */
+
+	/* Ensure playback is stopped. The READY state is enough to change
+	 * the uri, and unlike NULL, it leaves the audio sink open. Only the
+	 * source and the decoders are rebuilt, so switching is faster.
+	 */
+	set_gst_state(priv->playbin, GST_STATE_READY);
+
+	/* Done with the previous measure, a new one starts at source setup */
+	gv_engine_save_jitter(self);
+
+	/* Set the stream uri */
+	gv_engine_setup_buffering(self, priv->playbin, priv->station);
+	g_object_set(priv->playbin, "uri", stream_uri, NULL);
+
+	/* Set gst state to PAUSE, so that the playbin starts buffering data.
+	 * Playback will start as soon as buffering is finished.
+	 */
+	set_gst_state(priv->playbin, GST_STATE_PAUSED);
+	gv_engine_set_state(self, GV_ENGINE_STATE_CONNECTING);
+
+	/* Watch for a stream that never starts playing */
+	gv_engine_start_stall_watch(self);
+}
+
+/*
+ * Standby
+ *
+ * Pipelines for the stations that are likely to be played next. They are
+ * connected and left in the paused state, so that they buffer data. When
+ * one of these stations is played, the pipeline takes the place of the
+ * current one, and playback starts right away.
+ */
+
+static GstElement *gv_engine_make_playbin(GvEngine *self);
+static void gv_engine_watch_bus(GvEngine *self, GstBus *bus);
+static void gv_engine_watch_standby_bus(GvEngine *self, GstBus *bus);
+
+static void
+gv_engine_standby_free(GvEngineStandby *standby)
+{
+	if (standby->playbin) {
+		set_gst_state(standby->playbin, GST_STATE_NULL);
+		gst_bus_remove_signal_watch(standby->bus);
+		gst_object_unref(standby->bus);
+		gst_object_unref(standby->playbin);
+	}
+
+	if (standby->meter)
+		gv_engine_meter_unref(standby->meter);
+
+	g_object_unref(standby->station);
+	g_free(standby->stream_uri);
+	g_free(standby);
+}
+
+static GvEngineStandby *
+gv_engine_standby_new(GvEngine *self, GvStation *station, const gchar *stream_uri)
+{
+	GvEnginePrivate *priv = self->priv;
+	GvEngineStandby *standby;
+	GstElement *audio_sink;
+
+	standby = g_new0(GvEngineStandby, 1);
+	standby->station = g_object_ref(station);
+	standby->stream_uri = g_strdup(stream_uri);
+	standby->playbin = gv_engine_make_playbin(self);
+	g_object_set_data(G_OBJECT(standby->playbin), "gv-engine-standby", standby);
+
+	/* Failures were already reported for the main pipeline */
+	audio_sink = make_audio_sink(priv->pipeline_enabled, priv->pipeline_string, NULL);
+	if (audio_sink)
+		g_object_set(standby->playbin, "audio-sink", audio_sink, NULL);
+
+	standby->bus = gst_element_get_bus(standby->playbin);
+	gst_bus_add_signal_watch(standby->bus);
+	gv_engine_watch_standby_bus(self, standby->bus);
+
+	/* Connect and buffer, without playing */
+	gv_engine_setup_buffering(self, standby->playbin, station);
+	g_object_set(standby->playbin, "uri", stream_uri, NULL);
+	set_gst_state(standby->playbin, GST_STATE_PAUSED);
+
+	standby->start_time = g_get_monotonic_time();
+
+	DEBUG("Prebuffering stream '%s'", stream_uri);
+
+	return standby;
+}
+
+static GvEngineStandby *
+gv_engine_find_standby(GvEngine *self, GvStation *station, GstBus *bus)
+{
+	GvEnginePrivate *priv = self->priv;
+	GList *item;
+
+	for (item = priv->standbys; item; item = item->next) {
+		GvEngineStandby *standby = item->data;
+
+		if (station && standby->station == station)
+			return standby;
+		if (bus && standby->bus == bus)
+			return standby;
+	}
+
+	for (item = priv->racers; item && bus; item = item->next) {
+		GvEngineStandby *racer = item->data;
+
+		if (racer->bus == bus)
+			return racer;
+	}
+
+	return NULL;
+}
+
+static void
+gv_engine_drop_standby(GvEngine *self, GvEngineStandby *standby)
+{
+	GvEnginePrivate *priv = self->priv;
+
+	priv->standbys = g_list_remove(priv->standbys, standby);
+	priv->racers = g_list_remove(priv->racers, standby);
+	gv_engine_standby_free(standby);
+}
+
+static gboolean
+when_timeout_check_standbys(GvEngine *self)
+{
+	GvEnginePrivate *priv = self->priv;
+	gint64 now = g_get_monotonic_time();
+	GList *item;
+
+	if (priv->standbys == NULL) {
+		priv->standby_source_id = 0;
+		return G_SOURCE_REMOVE;
+	}
+
+	/* Start over the pipelines that were paused for too long. Going
+	 * through READY drops the source and the buffered data.
+	 */
+	for (item = priv->standbys; item; item = item->next) {
+		GvEngineStandby *standby = item->data;
+
+		if (now - standby->start_time < STANDBY_MAX_AGE * G_USEC_PER_SEC)
+			continue;
+
+		DEBUG("Refreshing prebuffered stream '%s'", standby->stream_uri);
+		set_gst_state(standby->playbin, GST_STATE_READY);
+		set_gst_state(standby->playbin, GST_STATE_PAUSED);
+		standby->buffered = FALSE;
+		standby->start_time = now;
+	}
+
+	return G_SOURCE_CONTINUE;
+}
+
+static void
+gv_engine_stop_race(GvEngine *self)
+{
+	GvEnginePrivate *priv = self->priv;
+
+	g_list_free_full(priv->racers, (GDestroyNotify) gv_engine_standby_free);
+	priv->racers = NULL;
+}
+
+static void
+gv_engine_start_race(GvEngine *self)
+{
+	GvEnginePrivate *priv = self->priv;
+	GSList *stream_uris;
+	GSList *item;
+	guint n_streams;
+	guint n;
+
+	/* Connect to the stream uris that follow the current one. Each of
+	 * them counts as a try, as far as failover is concerned.
+	 */
+	n_streams = g_settings_get_uint(gv_core_settings, "race-streams");
+	n_streams = MIN(n_streams, MAX_RACE_STREAMS);
+
+	stream_uris = gv_station_get_stream_uris(priv->station);
+	n_streams = MIN(n_streams, g_slist_length(stream_uris));
+
+	item = g_slist_find_custom(stream_uris, priv->stream_uri, (GCompareFunc) g_strcmp0);
+
+	for (n = 1; n < n_streams; n++) {
+		GvEngineStandby *racer;
+
+		item = item && item->next ? item->next : stream_uris;
+
+		racer = gv_engine_standby_new(self, priv->station, item->data);
+		racer->racing = TRUE;
+		priv->racers = g_list_append(priv->racers, racer);
+		priv->n_stream_tries++;
+	}
+}
+
+static void
+gv_engine_play_standby(GvEngine *self, GvEngineStandby *standby)
+{
+	GvEnginePrivate *priv = self->priv;
+	gdouble gst_volume;
+
+	DEBUG("Switching to prebuffered stream '%s'", standby->stream_uri);
+
+	priv->standbys = g_list_remove(priv->standbys, standby);
+	priv->racers = g_list_remove(priv->racers, standby);
+
+	/* The race is over, unless a racer takes over a failed stream */
+	if (standby->racing == FALSE || standby->buffered)
+		gv_engine_stop_race(self);
+
+	/* Get rid of the current pipeline */
+	gv_engine_stop_stall_watch(self);
+	set_gst_state(priv->playbin, GST_STATE_NULL);
+	gv_engine_save_jitter(self);
+	gst_bus_remove_signal_watch(priv->bus);
+	g_signal_handlers_disconnect_by_data(priv->bus, self);
+	gst_object_unref(priv->bus);
+	gst_object_unref(priv->playbin);
+
+	/* Take over the standby pipeline */
+	g_signal_handlers_disconnect_by_data(standby->bus, self);
+	g_object_set_data(G_OBJECT(standby->playbin), "gv-engine-standby", NULL);
+	priv->playbin = standby->playbin;
+	priv->bus = standby->bus;
+	priv->meter = standby->meter;
+	standby->meter = NULL;
+	gv_engine_watch_bus(self, priv->bus);
+	standby->playbin = NULL;
+	standby->bus = NULL;
+
+	gst_volume = (gdouble) priv->volume / 100.0;
+	gst_stream_volume_set_volume(GST_STREAM_VOLUME(priv->playbin),
+	                             GST_STREAM_VOLUME_FORMAT_CUBIC, gst_volume);
+	gst_stream_volume_set_mute(GST_STREAM_VOLUME(priv->playbin), priv->mute);
+
+	g_free(priv->stream_uri);
+	priv->stream_uri = g_strdup(standby->stream_uri);
+
+	/* Play right away if buffering is done, otherwise wait for it */
+	if (standby->buffered) {
+		gv_engine_start_playback(self);
+	} else {
+		gv_engine_set_state(self, GV_ENGINE_STATE_BUFFERING);
+		gv_engine_start_stall_watch(self);
+	}
+
+	gv_engine_standby_free(standby);
+}
+
+/*
+ * Reconnect
+ *
+ * When every stream of the station failed, we try again later, waiting
+ * longer after each failed attempt, and never giving up. The playbin is
+ * kept, only its state is changed.
+ */
+
+static void
+gv_engine_stop_reconnect(GvEngine *self)
+{
+	GvEnginePrivate *priv = self->priv;
+
+	if (priv->reconnect_source_id) {
+		g_source_remove(priv->reconnect_source_id);
+		priv->reconnect_source_id = 0;
+	}
+
+	/* Account for the time spent reconnecting */
+	if (priv->down_since) {
+		gint64 now = g_get_monotonic_time();
+
+		priv->downtime += (now - priv->down_since) / G_USEC_PER_SEC;
+		priv->down_since = 0;
+		g_object_notify_by_pspec(G_OBJECT(self), properties[PROP_DOWNTIME]);
+	}
+}
+
+static void
+gv_engine_reset_reconnect(GvEngine *self)
+{
+	GvEnginePrivate *priv = self->priv;
+
+	gv_engine_stop_reconnect(self);
+	priv->n_reconnect_tries = 0;
+
+	if (priv->reconnect_count) {
+		priv->reconnect_count = 0;
+		g_object_notify_by_pspec(G_OBJECT(self), properties[PROP_RECONNECT_COUNT]);
+	}
+
+	if (priv->downtime) {
+		priv->downtime = 0;
+		g_object_notify_by_pspec(G_OBJECT(self), properties[PROP_DOWNTIME]);
+	}
+}
+
+static gboolean
+when_timeout_reconnect(GvEngine *self)
+{
+	GvEnginePrivate *priv = self->priv;
+	const gchar *stream_uri;
+
+	priv->reconnect_source_id = 0;
+
+	stream_uri = gv_station_get_preferred_stream_uri(priv->station);
+	if (stream_uri == NULL) {
+		gv_engine_stop(self);
+		gv_errorable_emit_error(GV_ERRORABLE(self), "%s", _("No stream to reconnect to"));
+		return G_SOURCE_REMOVE;
+	}
+
+	INFO("Reconnecting to '%s' (attempt %u)", stream_uri, priv->n_reconnect_tries);
+
+	priv->reconnect_count++;
+	g_object_notify_by_pspec(G_OBJECT(self), properties[PROP_RECONNECT_COUNT]);
+
+	/* When the circuit breaker is open, it's a single probe: no racing,
+	 * and no failover to the other streams.
+	 */
+	if (priv->n_reconnect_tries > RECONNECT_MAX_TRIES) {
+		priv->n_stream_tries = G_MAXUINT;
+		gv_engine_play_stream(self, stream_uri);
+	} else {
+		priv->n_stream_tries = 1;
+		gv_engine_play_stream(self, stream_uri);
+		gv_engine_start_race(self);
+	}
+
+	return G_SOURCE_REMOVE;
+}
+
+static gboolean
+gv_engine_schedule_reconnect(GvEngine *self)
+{
+	GvEnginePrivate *priv = self->priv;
+	guint delay;
+
+	if (priv->station == NULL || priv->state == GV_ENGINE_STATE_STOPPED)
+		return FALSE;
+
+	if (priv->n_reconnect_tries >= RECONNECT_MAX_TRIES) {
+		/* Too many failures in a row, the circuit breaker is open */
+		if (priv->n_reconnect_tries == RECONNECT_MAX_TRIES)
+			WARNING("Station seems down, trying again every %u s",
+			        RECONNECT_COOLDOWN);
+		delay = RECONNECT_COOLDOWN * 1000;
+	} else {
+		/* Exponential backoff */
+		delay = RECONNECT_DELAY_MIN << MIN(priv->n_reconnect_tries, 16);
+		delay = MIN(delay, RECONNECT_DELAY_MAX);
+	}
+
+	/* A random half of the delay, so that players don't all come back
+	 * to the server at the same time.
+	 */
+	delay = delay / 2 + g_random_int_range(0, delay / 2 + 1);
+
+	priv->n_reconnect_tries++;
+	if (priv->down_since == 0)
+		priv->down_since = g_get_monotonic_time();
+
+	/* Wait with the pipeline stopped, keeping the audio sink open */
+	gv_engine_stop_stall_watch(self);
+	gv_engine_stop_race(self);
+	set_gst_state(priv->playbin, GST_STATE_READY);
+	gv_engine_set_state(self, GV_ENGINE_STATE_CONNECTING);
+
+	INFO("Reconnecting in %u ms", delay);
+	priv->reconnect_source_id = g_timeout_add(delay, (GSourceFunc) when_timeout_reconnect, self);
+
+	return TRUE;
+}
+
+/*
+ * Buffering
+ *
+ * For adaptive buffering, we measure how irregularly the data arrives
+ * at the source, and remember it per station. Next time the station is
+ * played, the buffer is sized accordingly.
+ *
+ * Each source gets its own meter, owned by the pad probe, so that the
+ * streaming thread never touches the engine. The pipeline holds another
+ * reference, to read the jitter when it's done with the source.
+ */
+
+static GvEngineMeter *
+gv_engine_meter_new(GvStation *station)
+{
+	GvEngineMeter *meter;
+
+	meter = g_new0(GvEngineMeter, 1);
+	meter->ref_count = 1;
+	meter->station_uri = station ? g_strdup(gv_station_get_uri(station)) : NULL;
+
+	return meter;
+}
+
+static GvEngineMeter *
+gv_engine_meter_ref(GvEngineMeter *meter)
+{
+	g_atomic_int_inc(&meter->ref_count);
+
+	return meter;
+}
+
+static void
+gv_engine_meter_unref(GvEngineMeter *meter)
+{
+	if (g_atomic_int_dec_and_test(&meter->ref_count) == FALSE)
+		return;
+
+	g_free(meter->station_uri);
+	g_free(meter);
+}
+
+static void
+gv_engine_save_jitter(GvEngine *self)
+{
+	GvEnginePrivate *priv = self->priv;
+	GvEngineMeter *meter = priv->meter;
+	gint jitter;
 
-	TRACE_GET_PROPERTY(object, property_id, value, pspec);
+	if (meter == NULL)
+		return;
 
-	switch (property_id) {
-	case PROP_STATE:
-		g_value_set_enum(value, gv_engine_get_state(self));
-		break;
-	case PROP_BITRATE:
-		g_value_set_uint(value, gv_engine_get_bitrate(self));
-		break;
-	case PROP_STATION:
-		g_value_set_object(value, gv_engine_get_station(self));
-		break;
-	case PROP_METADATA:
-		g_value_set_object(value, gv_engine_get_metadata(self));
-		break;
-	case PROP_VOLUME:
-		g_value_set_uint(value, gv_engine_get_volume(self));
-		break;
-	case PROP_MUTE:
-		g_value_set_boolean(value, gv_engine_get_mute(self));
-		break;
-	case PROP_PIPELINE_ENABLED:
-		g_value_set_boolean(value, gv_engine_get_pipeline_enabled(self));
-		break;
-	case PROP_PIPELINE_STRING:
-		g_value_set_string(value, gv_engine_get_pipeline_string(self));
-		break;
-	default:
-		G_OBJECT_WARN_INVALID_PROPERTY_ID(object, property_id, pspec);
-		break;
+	priv->meter = NULL;
+	jitter = g_atomic_int_get(&meter->jitter);
+
+	if (meter->station_uri && jitter > 0) {
+		DEBUG("Jitter for '%s': %d ms", meter->station_uri, jitter);
+		g_hash_table_replace(priv->jitters, g_strdup(meter->station_uri),
+		                     GINT_TO_POINTER(jitter));
 	}
+
+	gv_engine_meter_unref(meter);
 }
 
 static void
-gv_engine_set_property(GObject      *object,
-                       guint         property_id,
-                       const GValue *value,
-                       GParamSpec   *pspec)
+gv_engine_setup_buffering(GvEngine *self, GstElement *playbin, GvStation *station)
 {
-	GvEngine *self = GV_ENGINE(object);
+	GvEnginePrivate *priv = self->priv;
+	gint buffer_size;
+	gint buffer_duration;
 
-	TRACE_SET_PROPERTY(object, property_id, value, pspec);
+	buffer_size = g_settings_get_int(gv_core_settings, "buffer-size");
+	buffer_duration = g_settings_get_int(gv_core_settings, "buffer-duration");
 
-	switch (property_id) {
-	case PROP_VOLUME:
-		gv_engine_set_volume(self, g_value_get_uint(value));
-		break;
-	case PROP_MUTE:
-		gv_engine_set_mute(self, g_value_get_boolean(value));
-		break;
-	case PROP_PIPELINE_ENABLED:
-		gv_engine_set_pipeline_enabled(self, g_value_get_boolean(value));
-		break;
-	case PROP_PIPELINE_STRING:
-		gv_engine_set_pipeline_string(self, g_value_get_string(value));
-		break;
-	default:
-		G_OBJECT_WARN_INVALID_PROPERTY_ID(object, property_id, pspec);
-		break;
+	/* Watermarks are set when the queue is created, see element-setup */
+	priv->low_watermark = g_settings_get_uint(gv_core_settings, "buffer-low-watermark");
+	priv->high_watermark = g_settings_get_uint(gv_core_settings, "buffer-high-watermark");
+
+	if (priv->low_watermark >= priv->high_watermark) {
+		WARNING("Invalid buffer watermarks: %u-%u %%, using defaults",
+		        priv->low_watermark, priv->high_watermark);
+		priv->low_watermark = DEFAULT_LOW_WATERMARK;
+		priv->high_watermark = DEFAULT_HIGH_WATERMARK;
+	}
+
+	/* Stations that were never measured get the configured duration */
+	if (station && g_settings_get_boolean(gv_core_settings, "adaptive-buffering")) {
+		gpointer value;
+
+		if (g_hash_table_lookup_extended(priv->jitters, gv_station_get_uri(station),
+		                                 NULL, &value)) {
+			buffer_duration = GPOINTER_TO_INT(value) * ADAPTIVE_FACTOR;
+			buffer_duration = CLAMP(buffer_duration, ADAPTIVE_DURATION_MIN,
+			                        ADAPTIVE_DURATION_MAX);
+		}
 	}
+
+	DEBUG("Buffer size: %d kB, duration: %d ms, watermarks: %u-%u %%",
+	      buffer_size, buffer_duration, priv->low_watermark, priv->high_watermark);
+
+	g_object_set(playbin,
+	             "buffer-size", buffer_size < 0 ? -1 : buffer_size * 1024,
+	             "buffer-duration", buffer_duration < 0 ? (gint64) -1 :
+	             (gint64) buffer_duration * GST_MSECOND,
+	             NULL);
 }
 
 /*
@@ -534,48 +1300,45 @@ gv_engine_set_property(GObject      *object,
 void
 gv_engine_play(GvEngine *self, GvStation *station)
 {
-	GvEnginePrivate *priv = self->priv;
+	GvEngineStandby *standby;
 	const gchar *station_stream_uri;
 
 	g_return_if_fail(station != NULL);
 
-	/* Station must have a stream uri */
-	station_stream_uri = gv_station_get_first_stream_uri(station);
+	/* Station must have a stream uri. Start with the one that worked
+	 * last time, the other ones are tried if it fails.
+	 */
+	station_stream_uri = gv_station_get_preferred_stream_uri(station);
 	if (station_stream_uri == NULL) {
 		WARNING("Station '%s' has no stream uri",
 		        gv_station_get_name_or_uri(station));
+		gv_engine_stop(self);
 		return;
 	}
 
 	/* Set station */
 	gv_engine_set_station(self, station);
 
+	/* Start afresh */
+	gv_engine_reset_reconnect(self);
+	self->priv->play_time = g_get_monotonic_time();
+
 	/* Clear metadata */
 	gv_engine_set_metadata(self, NULL);
 
-	/* According to the doc:
-	 *
-	 * > State changes to GST_STATE_READY or GST_STATE_NULL never return
-	 * > GST_STATE_CHANGE_ASYNC.
-	 *
-	 * https://gstreamer.freedesktop.org/data/doc/gstreamer/head/gstreamer/html/
-	 * GstElement.html#gst-element-set-state
-	 */
-
-	/* Ensure playback is stopped */
-	set_gst_state(priv->playbin, GST_STATE_NULL);
-
-	/* Set the stream uri */
-	g_object_set(priv->playbin, "uri", station_stream_uri, NULL);
-
-	/* Go to the ready stop (not sure it's needed) */
-	set_gst_state(priv->playbin, GST_STATE_READY);
+	/* Use the prebuffered pipeline, if any */
+	standby = gv_engine_find_standby(self, station, NULL);
+	if (standby && !g_strcmp0(standby->stream_uri, station_stream_uri)) {
+		self->priv->n_stream_tries = 1;
+		gv_engine_play_standby(self, standby);
+		return;
+	}
 
-	/* Set gst state to PAUSE, so that the playbin starts buffering data.
-	 * Playback will start as soon as buffering is finished.
-	 */
-	set_gst_state(priv->playbin, GST_STATE_PAUSED);
-	gv_engine_set_state(self, GV_ENGINE_STATE_CONNECTING);
+	/* Play, and race against the other streams if any */
+	gv_engine_stop_race(self);
+	self->priv->n_stream_tries = 1;
+	gv_engine_play_stream(self, station_stream_uri);
+	gv_engine_start_race(self);
 }
 
 void
@@ -583,9 +1346,67 @@ gv_engine_stop(GvEngine *self)
 {
 	GvEnginePrivate *priv = self->priv;
 
+	/* No more failover */
+	gv_engine_stop_stall_watch(self);
+	gv_engine_stop_race(self);
+	gv_engine_stop_reconnect(self);
+	priv->n_reconnect_tries = 0;
+
 	/* Radical way to stop: set state to NULL */
 	set_gst_state(priv->playbin, GST_STATE_NULL);
 	gv_engine_set_state(self, GV_ENGINE_STATE_STOPPED);
+	gv_engine_save_jitter(self);
+}
+
+void
+gv_engine_set_standby_stations(GvEngine *self, GList *stations)
+{
+	GvEnginePrivate *priv = self->priv;
+	GList *item, *next;
+	guint n;
+
+	/* Drop the pipelines that are not wanted anymore */
+	for (item = priv->standbys; item; item = next) {
+		GvEngineStandby *standby = item->data;
+		const gchar *stream_uri;
+
+		next = item->next;
+		stream_uri = gv_station_get_preferred_stream_uri(standby->station);
+
+		if (g_list_find(stations, standby->station) &&
+		    !g_strcmp0(standby->stream_uri, stream_uri))
+			continue;
+
+		DEBUG("Dropping prebuffered stream '%s'", standby->stream_uri);
+		gv_engine_drop_standby(self, standby);
+	}
+
+	/* Prebuffer the new ones */
+	for (item = stations, n = 0; item && n < MAX_STANDBY_STATIONS; item = item->next, n++) {
+		GvStation *station = item->data;
+		GvEngineStandby *standby;
+		const gchar *stream_uri;
+
+		if (station == priv->station)
+			continue;
+
+		if (gv_engine_find_standby(self, station, NULL))
+			continue;
+
+		/* Stations whose playlist wasn't downloaded yet are skipped */
+		stream_uri = gv_station_get_preferred_stream_uri(station);
+		if (stream_uri == NULL)
+			continue;
+
+		standby = gv_engine_standby_new(self, station, stream_uri);
+		priv->standbys = g_list_append(priv->standbys, standby);
+	}
+
+	/* Keep them fresh */
+	if (priv->standbys && priv->standby_source_id == 0)
+		priv->standby_source_id = g_timeout_add_seconds
+		                          (STANDBY_CHECK_INTERVAL,
+		                           (GSourceFunc) when_timeout_check_standbys, self);
 }
 
 GvEngine *
@@ -598,13 +1419,66 @@ gv_engine_new(void)
  * GStreamer playbin signal handlers
  */
 
+static GstPadProbeReturn
+on_source_pad_buffer(GstPad          *pad G_GNUC_UNUSED,
+                     GstPadProbeInfo *info G_GNUC_UNUSED,
+                     GvEngineMeter   *meter)
+{
+	gint64 now;
+
+	/* This is called from the streaming thread. The jitter is the
+	 * longest gap between two arrivals, smoothed: it goes up fast,
+	 * and down slowly.
+	 */
+	now = g_get_monotonic_time();
+
+	if (meter->last_arrival) {
+		gint gap = (now - meter->last_arrival) / 1000;
+		gint jitter = g_atomic_int_get(&meter->jitter);
+
+		if (gap > jitter)
+			jitter += (gap - jitter + 3) / 4;
+		else
+			jitter -= (jitter - gap) / 64;
+
+		g_atomic_int_set(&meter->jitter, jitter);
+	}
+
+	meter->last_arrival = now;
+
+	return GST_PAD_PROBE_OK;
+}
+
+#if GST_CHECK_VERSION(1, 10, 0)
+static void
+on_playbin_element_setup(GstElement *playbin G_GNUC_UNUSED,
+                         GstElement *element,
+                         GvEngine   *self)
+{
+	GvEnginePrivate *priv = self->priv;
+	GstElementFactory *factory;
+
+	factory = gst_element_get_factory(element);
+	if (factory == NULL || g_strcmp0(GST_OBJECT_NAME(factory), "queue2"))
+		return;
+
+	g_object_set(element,
+	             "low-watermark", priv->low_watermark / 100.0,
+	             "high-watermark", priv->high_watermark / 100.0,
+	             NULL);
+}
+#endif
+
 static void
-on_playbin_source_setup(GstElement *playbin G_GNUC_UNUSED,
+on_playbin_source_setup(GstElement *playbin,
                         GstElement *source,
                         GvEngine   *self)
 {
 	GvEnginePrivate *priv = self->priv;
 	GvStation *station = priv->station;
+	GvEngineStandby *standby = NULL;
+	GvEngineMeter *meter;
+	GstPad *pad;
 	static gchar *default_user_agent;
 	const gchar *user_agent;
 
@@ -618,6 +1492,13 @@ on_playbin_source_setup(GstElement *playbin G_GNUC_UNUSED,
 
 	user_agent = default_user_agent;
 
+	/* Prebuffered and racing pipelines might belong to another station */
+	if (playbin != priv->playbin) {
+		standby = g_object_get_data(G_OBJECT(playbin), "gv-engine-standby");
+		if (standby)
+			station = standby->station;
+	}
+
 	if (station) {
 		const gchar *station_user_agent;
 
@@ -628,6 +1509,31 @@ on_playbin_source_setup(GstElement *playbin G_GNUC_UNUSED,
 
 	g_object_set(source, "user-agent", user_agent, NULL);
 	DEBUG("Source setup with user-agent '%s'", user_agent);
+
+	/* Measure data arrivals, for adaptive buffering */
+	if (playbin != priv->playbin && standby == NULL)
+		return;
+
+	meter = gv_engine_meter_new(station);
+
+	if (standby) {
+		if (standby->meter)
+			gv_engine_meter_unref(standby->meter);
+		standby->meter = meter;
+	} else {
+		if (priv->meter)
+			gv_engine_meter_unref(priv->meter);
+		priv->meter = meter;
+	}
+
+	pad = gst_element_get_static_pad(source, "src");
+	if (pad) {
+		gst_pad_add_probe(pad, GST_PAD_PROBE_TYPE_BUFFER,
+		                  (GstPadProbeCallback) on_source_pad_buffer,
+		                  gv_engine_meter_ref(meter),
+		                  (GDestroyNotify) gv_engine_meter_unref);
+		gst_object_unref(pad);
+	}
 }
 
 /*
@@ -640,6 +1546,10 @@ on_bus_message_eos(GstBus *bus G_GNUC_UNUSED, GstMessage *msg G_GNUC_UNUSED, GvE
 	/* This shouldn't happen, as far as I know */
 	WARNING("Unexpected eos message");
 
+	/* Try another stream, or reconnect later */
+	if (gv_engine_failover(self) || gv_engine_schedule_reconnect(self))
+		return TRUE;
+
 	/* Emit an error */
 	gv_errorable_emit_error(GV_ERRORABLE(self), "%s", _("End of stream"));
 
@@ -660,8 +1570,12 @@ on_bus_message_error(GstBus *bus G_GNUC_UNUSED, GstMessage *msg, GvEngine *self)
 	        g_quark_to_string(error->domain), error->code, error->message);
 	WARNING("Gst bus error debug: %s", debug);
 
-	/* Emit an error signal */
-	gv_errorable_emit_error(GV_ERRORABLE(self), "GStreamer error: %s", error->message);
+	/* Try another stream, or reconnect later if the error is likely to
+	 * go away, or emit an error signal.
+	 */
+	if (gv_engine_failover(self) == FALSE &&
+	    (is_error_transient(error) == FALSE || gv_engine_schedule_reconnect(self) == FALSE))
+		gv_errorable_emit_error(GV_ERRORABLE(self), "GStreamer error: %s", error->message);
 
 	/* Cleanup */
 	g_error_free(error);
@@ -888,6 +1802,14 @@ on_bus_message_buffering(GstBus *bus G_GNUC_UNUSED, GstMessage *msg, GvEngine *s
 		DEBUG("Buffering (%3u %%)", percent);
 	}
 
+	/* As long as buffering makes progress, the stream is not stalled */
+	if (priv->stall_source_id && percent > priv->stall_percent) {
+		gint stall_percent = percent;
+
+		gv_engine_start_stall_watch(self);
+		priv->stall_percent = stall_percent;
+	}
+
 	/* Now, let's react according to our current state */
 	switch (priv->state) {
 	case GV_ENGINE_STATE_STOPPED:
@@ -909,8 +1831,7 @@ on_bus_message_buffering(GstBus *bus G_GNUC_UNUSED, GstMessage *msg, GvEngine *s
 		/* When buffering complete, start playing */
 		if (percent >= 100) {
 			DEBUG("Buffering complete, starting playback");
-			set_gst_state(priv->playbin, GST_STATE_PLAYING);
-			gv_engine_set_state(self, GV_ENGINE_STATE_PLAYING);
+			gv_engine_start_playback(self);
 		}
 		break;
 
@@ -960,6 +1881,129 @@ on_bus_message_state_changed(GstBus *bus G_GNUC_UNUSED, GstMessage *msg,
 	return TRUE;
 }
 
+static gboolean
+on_standby_bus_message_error(GstBus *bus, GstMessage *msg, GvEngine *self)
+{
+	GvEngineStandby *standby;
+	GError *error;
+	gchar  *debug;
+
+	standby = gv_engine_find_standby(self, NULL, bus);
+	if (standby == NULL)
+		return TRUE;
+
+	/* Not worth an error signal, it's just dropped */
+	gst_message_parse_error(msg, &error, &debug);
+	DEBUG("Prebuffered stream '%s' failed: %s", standby->stream_uri, error->message);
+	g_error_free(error);
+	g_free(debug);
+
+	gv_engine_drop_standby(self, standby);
+
+	return TRUE;
+}
+
+static gboolean
+on_standby_bus_message_eos(GstBus *bus, GstMessage *msg G_GNUC_UNUSED, GvEngine *self)
+{
+	GvEngineStandby *standby;
+
+	standby = gv_engine_find_standby(self, NULL, bus);
+	if (standby == NULL)
+		return TRUE;
+
+	/* The server closed the connection */
+	DEBUG("Prebuffered stream '%s' ended", standby->stream_uri);
+	gv_engine_drop_standby(self, standby);
+
+	return TRUE;
+}
+
+static gboolean
+on_standby_bus_message_buffering(GstBus *bus, GstMessage *msg, GvEngine *self)
+{
+	GvEngineStandby *standby;
+	gint percent = 0;
+
+	standby = gv_engine_find_standby(self, NULL, bus);
+	if (standby == NULL)
+		return TRUE;
+
+	gst_message_parse_buffering(msg, &percent);
+
+	if (percent >= 100 && standby->buffered == FALSE)
+		DEBUG("Prebuffered stream '%s' is ready", standby->stream_uri);
+
+	standby->buffered = percent >= 100;
+
+	/* First racer to be ready wins */
+	if (standby->racing && standby->buffered) {
+		INFO("Stream '%s' won the race", standby->stream_uri);
+		gv_engine_play_standby(self, standby);
+	}
+
+	return TRUE;
+}
+
+/*
+ * GStreamer setup
+ */
+
+static GstElement *
+gv_engine_make_playbin(GvEngine *self)
+{
+	GstElement *playbin;
+	GstElement *fakesink;
+
+	/* Make the playbin - returns floating ref */
+	playbin = gst_element_factory_make("playbin", NULL);
+	g_assert_nonnull(playbin);
+	g_object_ref_sink(playbin);
+
+	/* Connect playbin signal handlers */
+	g_signal_connect_object(playbin, "source-setup", G_CALLBACK(on_playbin_source_setup), self, 0);
+#if GST_CHECK_VERSION(1, 10, 0)
+	g_signal_connect_object(playbin, "element-setup", G_CALLBACK(on_playbin_element_setup), self, 0);
+#endif
+
+	/* Disable video - returns floating ref */
+	fakesink = gst_element_factory_make("fakesink", NULL);
+	g_assert_nonnull(fakesink);
+	g_object_set(playbin, "video-sink", fakesink, NULL);
+
+	return playbin;
+}
+
+static void
+gv_engine_watch_bus(GvEngine *self, GstBus *bus)
+{
+	g_signal_connect_object(bus, "message::eos",
+	                        G_CALLBACK(on_bus_message_eos), self, 0);
+	g_signal_connect_object(bus, "message::error",
+	                        G_CALLBACK(on_bus_message_error), self, 0);
+	g_signal_connect_object(bus, "message::warning",
+	                        G_CALLBACK(on_bus_message_warning), self, 0);
+	g_signal_connect_object(bus, "message::info",
+	                        G_CALLBACK(on_bus_message_info), self, 0);
+	g_signal_connect_object(bus, "message::tag",
+	                        G_CALLBACK(on_bus_message_tag), self, 0);
+	g_signal_connect_object(bus, "message::buffering",
+	                        G_CALLBACK(on_bus_message_buffering), self, 0);
+	g_signal_connect_object(bus, "message::state-changed",
+	                        G_CALLBACK(on_bus_message_state_changed), self, 0);
+}
+
+static void
+gv_engine_watch_standby_bus(GvEngine *self, GstBus *bus)
+{
+	g_signal_connect_object(bus, "message::eos",
+	                        G_CALLBACK(on_standby_bus_message_eos), self, 0);
+	g_signal_connect_object(bus, "message::error",
+	                        G_CALLBACK(on_standby_bus_message_error), self, 0);
+	g_signal_connect_object(bus, "message::buffering",
+	                        G_CALLBACK(on_standby_bus_message_buffering), self, 0);
+}
+
 /*
  * GObject methods
  */
@@ -973,6 +2017,12 @@ gv_engine_finalize(GObject *object)
 	TRACE("%p", object);
 
 	/* Stop playback at first */
+	gv_engine_stop_stall_watch(self);
+	gv_engine_stop_race(self);
+	gv_engine_stop_reconnect(self);
+	if (priv->standby_source_id)
+		g_source_remove(priv->standby_source_id);
+	g_list_free_full(priv->standbys, (GDestroyNotify) gv_engine_standby_free);
 	set_gst_state(priv->playbin, GST_STATE_NULL);
 
 	/* Unref the bus */
@@ -988,6 +2038,10 @@ gv_engine_finalize(GObject *object)
 
 	/* Free resources */
 	g_free(priv->pipeline_string);
+	g_free(priv->stream_uri);
+	if (priv->meter)
+		gv_engine_meter_unref(priv->meter);
+	g_hash_table_destroy(priv->jitters);
 
 	/* Chain up */
 	G_OBJECT_CHAINUP_FINALIZE(gv_engine, object);
@@ -998,8 +2052,6 @@ gv_engine_constructed(GObject *object)
 {
 	GvEngine *self = GV_ENGINE(object);
 	GvEnginePrivate *priv = self->priv;
-	GstElement *playbin;
-	GstElement *fakesink;
 	GstBus *bus;
 
 	/* Initialize properties */
@@ -1007,25 +2059,16 @@ gv_engine_constructed(GObject *object)
 	priv->mute   = DEFAULT_MUTE;
 	priv->pipeline_enabled = FALSE;
 	priv->pipeline_string  = NULL;
+	priv->jitters = g_hash_table_new_full(g_str_hash, g_str_equal, g_free, NULL);
 
 	/* GStreamer must be initialized, let's check that */
 	g_assert(gst_is_initialized());
 
-	/* Make the playbin - returns floating ref */
-	playbin = gst_element_factory_make("playbin", "playbin");
-	g_assert_nonnull(playbin);
-	priv->playbin = g_object_ref_sink(playbin);
-
-	/* Connect playbin signal handlers */
-	g_signal_connect_object(playbin, "source-setup", G_CALLBACK(on_playbin_source_setup), self, 0);
-
-	/* Disable video - returns floating ref */
-	fakesink = gst_element_factory_make("fakesink", "fakesink");
-	g_assert_nonnull(fakesink);
-	g_object_set(playbin, "video-sink", fakesink, NULL);
+	/* Make the playbin */
+	priv->playbin = gv_engine_make_playbin(self);
 
 	/* Get a reference to the message bus - returns full ref */
-	bus = gst_element_get_bus(playbin);
+	bus = gst_element_get_bus(priv->playbin);
 	g_assert_nonnull(bus);
 	priv->bus = bus;
 
@@ -1033,20 +2076,7 @@ gv_engine_constructed(GObject *object)
 	gst_bus_add_signal_watch(bus);
 
 	/* Connect bus signal handlers */
-	g_signal_connect_object(bus, "message::eos",
-	                        G_CALLBACK(on_bus_message_eos), self, 0);
-	g_signal_connect_object(bus, "message::error",
-	                        G_CALLBACK(on_bus_message_error), self, 0);
-	g_signal_connect_object(bus, "message::warning",
-	                        G_CALLBACK(on_bus_message_warning), self, 0);
-	g_signal_connect_object(bus, "message::info",
-	                        G_CALLBACK(on_bus_message_info), self, 0);
-	g_signal_connect_object(bus, "message::tag",
-	                        G_CALLBACK(on_bus_message_tag), self, 0);
-	g_signal_connect_object(bus, "message::buffering",
-	                        G_CALLBACK(on_bus_message_buffering), self, 0);
-	g_signal_connect_object(bus, "message::state-changed",
-	                        G_CALLBACK(on_bus_message_state_changed), self, 0);
+	gv_engine_watch_bus(self, bus);
 
 	/* Chain up */
 	G_OBJECT_CHAINUP_CONSTRUCTED(gv_engine, object);
@@ -1116,5 +2146,15 @@ gv_engine_class_init(GvEngineClass *class)
 	        g_param_spec_string("pipeline-string", "Custom pipeline string", NULL, NULL,
 	                            GV_PARAM_DEFAULT_FLAGS | G_PARAM_READWRITE);
 
+	properties[PROP_RECONNECT_COUNT] =
+	        g_param_spec_uint("reconnect-count", "Reconnections since playback started", NULL,
+	                          0, G_MAXUINT, 0,
+	                          GV_PARAM_DEFAULT_FLAGS | G_PARAM_READABLE);
+
+	properties[PROP_DOWNTIME] =
+	        g_param_spec_uint("downtime", "Seconds lost reconnecting since playback started", NULL,
+	                          0, G_MAXUINT, 0,
+	                          GV_PARAM_DEFAULT_FLAGS | G_PARAM_READABLE);
+
 	g_object_class_install_properties(object_class, PROP_N, properties);
 }
@@ -48,6 +48,7 @@ typedef enum {
 GvEngine *gv_engine_new (void);
 void      gv_engine_play(GvEngine *self, GvStation *station);
 void      gv_engine_stop(GvEngine *self);
+void      gv_engine_set_standby_stations(GvEngine *self, GList *stations);
 
 /* Property accessors */
 
@@ -62,5 +63,7 @@ gboolean       gv_engine_get_pipeline_enabled(GvEngine *self);
 void           gv_engine_set_pipeline_enabled(GvEngine *self, gboolean enabled);
 const gchar   *gv_engine_get_pipeline_string (GvEngine *self);
 void           gv_engine_set_pipeline_string (GvEngine *self, const gchar *pipeline);
+guint          gv_engine_get_reconnect_count (GvEngine *self);
+guint          gv_engine_get_downtime        (GvEngine *self);
 
 #endif /* __GOODVIBES_CORE_GV_ENGINE_H__ */
@@ -30,6 +30,7 @@
 #include "core/gv-core-enum-types.h"
 #include "core/gv-core-internal.h"
 #include "core/gv-metadata.h"
+#include "core/gv-playlist.h"
 #include "core/gv-station.h"
 #include "core/gv-station-list.h"
 
@@ -44,6 +45,8 @@
 #define DEFAULT_REPEAT   FALSE
 #define DEFAULT_SHUFFLE  FALSE
 #define DEFAULT_AUTOPLAY FALSE
+#define DEFAULT_STANDBY_STATIONS 0
+#define MAX_STANDBY_STATIONS     4
 
 enum {
 	/* Reserved */
@@ -63,6 +66,7 @@ enum {
 	PROP_REPEAT,
 	PROP_SHUFFLE,
 	PROP_AUTOPLAY,
+	PROP_STANDBY_STATIONS,
 	PROP_STATION,
 	PROP_STATION_URI,
 	PROP_PREV_STATION,
@@ -91,6 +95,7 @@ struct _GvPlayerPrivate {
 	gboolean       repeat;
 	gboolean       shuffle;
 	gboolean       autoplay;
+	guint          standby_stations;
 	/* Current station */
 	GvStation     *station;
 	/* Wished state */
@@ -119,6 +124,7 @@ G_DEFINE_TYPE_WITH_CODE(GvPlayer, gv_player, G_TYPE_OBJECT,
  */
 
 static void gv_player_set_state(GvPlayer *self, GvPlayerState value);
+static void gv_player_update_standby(GvPlayer *self);
 
 static void
 on_station_notify(GvStation *station,
@@ -201,6 +207,10 @@ on_engine_notify(GvEngine  *engine,
 
 		/* Set state */
 		gv_player_set_state(self, player_state);
+
+		/* Prebuffer the neighbours once we're playing */
+		if (engine_state == GV_ENGINE_STATE_PLAYING)
+			gv_player_update_standby(self);
 	}
 }
 
@@ -437,6 +447,28 @@ gv_player_set_autoplay(GvPlayer *self, gboolean autoplay)
 	g_object_notify_by_pspec(G_OBJECT(self), properties[PROP_AUTOPLAY]);
 }
 
+guint
+gv_player_get_standby_stations(GvPlayer *self)
+{
+	return self->priv->standby_stations;
+}
+
+void
+gv_player_set_standby_stations(GvPlayer *self, guint n_stations)
+{
+	GvPlayerPrivate *priv = self->priv;
+
+	if (n_stations > MAX_STANDBY_STATIONS)
+		n_stations = MAX_STANDBY_STATIONS;
+
+	if (priv->standby_stations == n_stations)
+		return;
+
+	priv->standby_stations = n_stations;
+	gv_player_update_standby(self);
+	g_object_notify_by_pspec(G_OBJECT(self), properties[PROP_STANDBY_STATIONS]);
+}
+
 GvStation *
 gv_player_get_station(GvPlayer *self)
 {
@@ -484,6 +516,8 @@ gv_player_set_station(GvPlayer *self, GvStation *station)
 		return;
 
 	if (priv->station) {
+		/* Whatever was going on for the previous station is obsolete */
+		gv_station_cancel_download(priv->station);
 		g_signal_handlers_disconnect_by_data(priv->station, self);
 		g_object_unref(priv->station);
 		priv->station = NULL;
@@ -590,6 +624,9 @@ gv_player_get_property(GObject    *object,
 	case PROP_AUTOPLAY:
 		g_value_set_boolean(value, gv_player_get_autoplay(self));
 		break;
+	case PROP_STANDBY_STATIONS:
+		g_value_set_uint(value, gv_player_get_standby_stations(self));
+		break;
 	case PROP_STATION:
 		g_value_set_object(value, gv_player_get_station(self));
 		break;
@@ -646,6 +683,9 @@ gv_player_set_property(GObject      *object,
 	case PROP_AUTOPLAY:
 		gv_player_set_autoplay(self, g_value_get_boolean(value));
 		break;
+	case PROP_STANDBY_STATIONS:
+		gv_player_set_standby_stations(self, g_value_get_uint(value));
+		break;
 	case PROP_STATION:
 		gv_player_set_station(self, g_value_get_object(value));
 		break;
@@ -658,6 +698,59 @@ gv_player_set_property(GObject      *object,
 	}
 }
 
+/*
+ * Private methods
+ */
+
+static void
+gv_player_update_standby(GvPlayer *self)
+{
+	GvPlayerPrivate *priv = self->priv;
+	GvStation *prevs[MAX_STANDBY_STATIONS] = { NULL };
+	GvStation *nexts[MAX_STANDBY_STATIONS] = { NULL };
+	GvStation *station;
+	GList *stations = NULL;
+	guint i;
+
+	/* Take the stations around the current one. Only while playing, as
+	 * it's pointless otherwise.
+	 *
+	 * In shuffle mode, asking for the previous station can reshuffle
+	 * the part that was not drawn yet. So we ask for all the previous
+	 * stations first, and then the next ones. From then on, the station
+	 * list gives the same answers when the player moves.
+	 */
+	if (priv->wish == GV_PLAYER_WISH_TO_PLAY && priv->station) {
+		station = priv->station;
+		for (i = 0; i < priv->standby_stations && station; i++) {
+			station = gv_station_list_prev(priv->station_list, station,
+			                               priv->repeat, priv->shuffle);
+			prevs[i] = station;
+		}
+
+		station = priv->station;
+		for (i = 0; i < priv->standby_stations && station; i++) {
+			station = gv_station_list_next(priv->station_list, station,
+			                               priv->repeat, priv->shuffle);
+			nexts[i] = station;
+		}
+	}
+
+	/* Closest neighbours come first, alternating next and previous */
+	for (i = 0; i < priv->standby_stations; i++) {
+		if (nexts[i] && nexts[i] != priv->station && !g_list_find(stations, nexts[i]))
+			stations = g_list_append(stations, nexts[i]);
+		if (prevs[i] && prevs[i] != priv->station && !g_list_find(stations, prevs[i]))
+			stations = g_list_append(stations, prevs[i]);
+	}
+
+	while (g_list_length(stations) > priv->standby_stations)
+		stations = g_list_delete_link(stations, g_list_last(stations));
+
+	gv_engine_set_standby_stations(priv->engine, stations);
+	g_list_free(stations);
+}
+
 /*
  * Public methods
  */
@@ -670,8 +763,9 @@ gv_player_stop(GvPlayer *self)
 	/* To remember what we're doing */
 	priv->wish = GV_PLAYER_WISH_TO_STOP;
 
-	/* Stop playing */
+	/* Stop playing, and don't keep other streams around */
 	gv_engine_stop(priv->engine);
+	gv_engine_set_standby_stations(priv->engine, NULL);
 }
 
 void
@@ -697,9 +791,6 @@ gv_player_play(GvPlayer *self)
 	/* To remember what we're doing */
 	priv->wish = GV_PLAYER_WISH_TO_PLAY;
 
-	/* Stop playing */
-	gv_engine_stop(priv->engine);
-
 	/* Get station data */
 	uris = gv_station_get_stream_uris(station);
 
@@ -707,6 +798,9 @@ gv_player_play(GvPlayer *self)
 	 * points to a playlist, and we need to download it.
 	 */
 	if (uris == NULL) {
+		/* Stop playing meanwhile */
+		gv_engine_stop(priv->engine);
+
 		/* Download the playlist that contains the stream uris */
 		if (!gv_station_download_playlist(station))
 			WARNING("Can't download playlist");
@@ -716,8 +810,14 @@ gv_player_play(GvPlayer *self)
 		 */
 		return;
 	} else {
-		/* Play the station */
+		/* Play the station. There's no need to stop first, the engine
+		 * switches streams without closing the audio sink.
+		 */
 		gv_engine_play(priv->engine, station);
+
+		/* Stream uris might come from the cache, revalidate them */
+		if (!gv_playlist_is_stream_uri(gv_station_get_uri(station)))
+			gv_station_download_playlist(station);
 	}
 }
 
@@ -855,6 +955,8 @@ gv_player_configure(GvConfigurable *configurable)
 	                self, "shuffle", G_SETTINGS_BIND_DEFAULT);
 	g_settings_bind(gv_core_settings, "autoplay",
 	                self, "autoplay", G_SETTINGS_BIND_DEFAULT);
+	g_settings_bind(gv_core_settings, "standby-stations",
+	                self, "standby-stations", G_SETTINGS_BIND_DEFAULT);
 	g_settings_bind(gv_core_settings, "station-uri",
 	                self, "station-uri", G_SETTINGS_BIND_DEFAULT);
 }
@@ -907,6 +1009,7 @@ gv_player_constructed(GObject *object)
 	priv->repeat   = DEFAULT_REPEAT;
 	priv->shuffle  = DEFAULT_SHUFFLE;
 	priv->autoplay = DEFAULT_AUTOPLAY;
+	priv->standby_stations = DEFAULT_STANDBY_STATIONS;
 	priv->station  = NULL;
 
 	/* Chain up */
@@ -1003,6 +1106,11 @@ gv_player_class_init(GvPlayerClass *class)
 	                             DEFAULT_AUTOPLAY,
 	                             GV_PARAM_DEFAULT_FLAGS | G_PARAM_READWRITE);
 
+	properties[PROP_STANDBY_STATIONS] =
+	        g_param_spec_uint("standby-stations", "Number of stations kept prebuffered", NULL,
+	                          0, MAX_STANDBY_STATIONS, DEFAULT_STANDBY_STATIONS,
+	                          GV_PARAM_DEFAULT_FLAGS | G_PARAM_READWRITE);
+
 	properties[PROP_METADATA] =
 	        g_param_spec_object("metadata", "Current metadata", NULL,
 	                            GV_TYPE_METADATA,
@@ -77,6 +77,8 @@ gboolean     gv_player_get_shuffle     (GvPlayer *self);
 void         gv_player_set_shuffle     (GvPlayer *self, gboolean shuffle);
 gboolean     gv_player_get_autoplay    (GvPlayer *self);
 void         gv_player_set_autoplay    (GvPlayer *self, gboolean autoplay);
+guint        gv_player_get_standby_stations(GvPlayer *self);
+void         gv_player_set_standby_stations(GvPlayer *self, guint n_stations);
 guint        gv_player_get_volume      (GvPlayer *self);
 void         gv_player_set_volume      (GvPlayer *self, guint volume);
 void         gv_player_lower_volume    (GvPlayer *self);
@@ -32,11 +32,13 @@
 #include <string.h>
 #include <glib.h>
 #include <glib-object.h>
+#include <gio/gio.h>
 #include <libsoup/soup.h>
 
 #include "additions/glib-object.h"
 #include "framework/gv-framework.h"
 
+#include "core/gv-core-internal.h"
 #include "core/gv-playlist.h"
 
 // WISHED Test with a lot, really a lot of different stations.
@@ -78,9 +80,29 @@ static guint signals[SIGNAL_N];
  */
 
 struct _GvPlaylistPrivate {
-	gchar             *uri;
-	GvPlaylistFormat format;
+	gchar            *uri;
+	GvPlaylistFormat  format;
 	GSList           *streams;
+	/* Download in progress */
+	gboolean          downloading;
+	gboolean          orphaned;
+	SoupMessage      *msg;
+	GInputStream     *input;
+	GByteArray       *buffer;
+	GCancellable     *cancellable;
+	guint             deadline_id;
+	gchar            *user_agent;
+	gchar            *etag;
+	gchar            *last_modified;
+	/* Nested playlists */
+	guint             depth;
+	GHashTable       *ancestors;
+	GSList           *nested_uris;
+	GPtrArray        *children;
+	guint             n_children_pending;
+	/* Same playlist downloaded at the same time */
+	GvPlaylist       *leader;
+	GSList           *waiters;
 };
 
 typedef struct _GvPlaylistPrivate GvPlaylistPrivate;
@@ -98,123 +120,420 @@ G_DEFINE_TYPE_WITH_PRIVATE(GvPlaylist, gv_playlist, G_TYPE_OBJECT)
  * Helpers
  */
 
-typedef GSList *(*PlaylistParser) (const gchar *, gsize);
+/* Parsers return a list of stream uris. If titles is not NULL, it's set
+ * to a list of the same length, with the title of each stream, or NULL.
+ */
+typedef GSList *(*PlaylistParser) (const gchar *, gsize, GSList **);
+
+/* Get the next line of a text, stripped of leading & trailing whitespaces.
+ * The line points inside the text, it's not nul-terminated. Both `\n` and
+ * `\r\n` line endings are handled, since `\r` is a whitespace.
+ */
+
+static gboolean
+next_line(const gchar **text, const gchar *end, const gchar **line, gsize *line_len)
+{
+	const gchar *start = *text;
+	const gchar *stop;
+	const gchar *eol;
+
+	if (start >= end)
+		return FALSE;
+
+	eol = memchr(start, '\n', end - start);
+	if (eol == NULL)
+		eol = end;
+
+	stop = eol;
+	while (start < stop && g_ascii_isspace(*start))
+		start++;
+	while (stop > start && g_ascii_isspace(stop[-1]))
+		stop--;
+
+	*line = start;
+	*line_len = stop - start;
+	*text = eol < end ? eol + 1 : end;
+
+	return TRUE;
+}
 
 /* Parse a M3U playlist, which is a simple text file,
  * each line being an uri.
  * https://en.wikipedia.org/wiki/M3U
+ *
+ * In extended M3U, the title comes after the first comma of the #EXTINF
+ * line preceding the uri. Attributes before it might be quoted, and
+ * contain commas as well.
  */
 
+static gchar *
+m3u_get_title(const gchar *info, const gchar *end)
+{
+	const gchar *p;
+	gboolean quoted = FALSE;
+
+	for (p = info; p < end; p++) {
+		if (*p == '"')
+			quoted = !quoted;
+		else if (*p == ',' && !quoted)
+			break;
+	}
+
+	if (p >= end)
+		return NULL;
+
+	p++;
+	while (p < end && g_ascii_isspace(*p))
+		p++;
+
+	return p < end ? g_strndup(p, end - p) : NULL;
+}
+
 static GSList *
-parse_playlist_m3u(const gchar *text, gsize text_size G_GNUC_UNUSED)
+parse_playlist_m3u(const gchar *text, gsize text_size, GSList **titles)
 {
+	const gchar *end = text + text_size;
+	const gchar *line;
+	gsize line_len;
+	gchar *title = NULL;
 	GSList *list = NULL;
-	const gchar *eol;
-	gchar **lines;
-	guint i;
 
-	/* Guess which delimiter is used to separate each lines.
-	 * Traditionnaly, UNIX would only use `\n`, Windows would use `\r\n`.
-	 */
-	if (strstr(text, "\r\n"))
-		eol = "\r\n";
-	else
-		eol = "\n";
+	while (next_line(&text, end, &line, &line_len)) {
+		/* Ignore emtpy lines and comments, except for titles */
+		if (line_len == 0)
+			continue;
+
+		if (line[0] == '#') {
+			if (line_len > 8 && !strncmp(line, "#EXTINF:", 8)) {
+				g_free(title);
+				title = m3u_get_title(line + 8, line + line_len);
+			}
+			continue;
+		}
 
-	/* Split into different lines */
-	lines = g_strsplit(text, eol, -1);
-	if (lines == NULL) {
+		/* If it's not an URI, we discard it */
+		if (!g_strstr_len(line, line_len, "://"))
+			continue;
+
+		/* Add to stream list */
+		list = g_slist_prepend(list, g_strndup(line, line_len));
+
+		/* The title applies to this uri only */
+		if (titles)
+			*titles = g_slist_prepend(*titles, title);
+		else
+			g_free(title);
+		title = NULL;
+	}
+
+	g_free(title);
+
+	if (list == NULL)
 		WARNING("Empty m3u playlist");
-		return NULL;
+
+	if (titles)
+		*titles = g_slist_reverse(*titles);
+
+	return g_slist_reverse(list);
+}
+
+/* Parse a HLS playlist, which is a M3U playlist with extra tags.
+ * https://tools.ietf.org/html/rfc8216
+ *
+ * A master playlist lists variants of the same stream, at different
+ * bitrates. They're returned best first, according to the maximum bitrate
+ * allowed, so that the engine tries the most suitable one first.
+ *
+ * A media playlist lists the segments of a stream. It's not resolved any
+ * further, the playlist uri is the stream uri.
+ */
+
+typedef struct {
+	guint64  bandwidth;
+	gchar   *uri;
+} HlsVariant;
+
+static gint
+hls_variant_cmp(gconstpointer a, gconstpointer b)
+{
+	const HlsVariant *va = a;
+	const HlsVariant *vb = b;
+
+	/* Highest bandwidth first */
+	return va->bandwidth > vb->bandwidth ? -1 : va->bandwidth < vb->bandwidth;
+}
+
+static gboolean
+is_hls_playlist(const gchar *text, gsize text_size)
+{
+	return g_strstr_len(text, text_size, "#EXT-X-") != NULL;
+}
+
+/* Get the BANDWIDTH attribute of a #EXT-X-STREAM-INF tag. Attributes are
+ * separated by commas, and quoted values might contain commas as well.
+ */
+
+static guint64
+hls_get_bandwidth(const gchar *attrs, const gchar *end)
+{
+	const gchar *p = attrs;
+	gboolean quoted = FALSE;
+
+	while (p < end) {
+		if (p == attrs || (!quoted && p[-1] == ',')) {
+			if (end - p > 10 && !strncmp(p, "BANDWIDTH=", 10))
+				return g_ascii_strtoull(p + 10, NULL, 10);
+		}
+
+		if (*p == '"')
+			quoted = !quoted;
+		p++;
 	}
 
-	/* Iterate on lines */
-	for (i = 0; lines[i] != NULL; i++) {
-		gchar *line = lines[i];
+	return 0;
+}
+
+static GSList *
+parse_playlist_hls(const gchar *base_uri, const gchar *text, gsize text_size,
+                   guint max_bitrate)
+{
+	const gchar *end = text + text_size;
+	const gchar *line;
+	gsize line_len;
+	gboolean is_media = FALSE;
+	gboolean is_variant = FALSE;
+	guint64 bandwidth = 0;
+	GSList *list = NULL;
+	SoupURI *base;
+	GArray *variants;
+	guint i, first;
+
+	base = soup_uri_new(base_uri);
+	variants = g_array_new(FALSE, FALSE, sizeof(HlsVariant));
 
-		/* Remove leading & trailing whitespaces */
-		line = g_strstrip(line);
+	while (next_line(&text, end, &line, &line_len)) {
+		HlsVariant variant;
+		SoupURI *uri;
 
-		/* Ignore emtpy lines and comments */
-		if (line[0] == '\0' || line[0] == '#')
+		if (line_len == 0)
 			continue;
 
-		/* If it's not an URI, we discard it */
-		if (!strstr(line, "://"))
+		if (line[0] == '#') {
+			if (line_len > 18 && !strncmp(line, "#EXT-X-STREAM-INF:", 18)) {
+				bandwidth = hls_get_bandwidth(line + 18, line + line_len);
+				is_variant = TRUE;
+			} else if (line_len >= 7 && !strncmp(line, "#EXTINF", 7)) {
+				is_media = TRUE;
+			}
 			continue;
+		}
 
-		/* Add to stream list */
-		list = g_slist_append(list, g_strdup(line));
+		/* Only the uri following a #EXT-X-STREAM-INF tag is a variant */
+		if (!is_variant)
+			continue;
+
+		variant.bandwidth = bandwidth;
+		is_variant = FALSE;
+
+		/* Variant uris might be relative to the playlist uri */
+		variant.uri = g_strndup(line, line_len);
+		uri = base ? soup_uri_new_with_base(base, variant.uri) : NULL;
+		if (uri) {
+			g_free(variant.uri);
+			variant.uri = soup_uri_to_string(uri, FALSE);
+			soup_uri_free(uri);
+		}
+
+		g_array_append_val(variants, variant);
+	}
+
+	if (base)
+		soup_uri_free(base);
+
+	/* A media playlist is a stream by itself */
+	if (variants->len == 0) {
+		g_array_free(variants, TRUE);
+
+		if (!is_media)
+			return NULL;
+
+		return g_slist_append(NULL, g_strdup(base_uri));
+	}
+
+	/* Best variant below the maximum bitrate first, then the ones below,
+	 * then the ones above, smallest first.
+	 */
+	g_array_sort(variants, hls_variant_cmp);
+
+	for (first = 0; first < variants->len && max_bitrate > 0; first++) {
+		HlsVariant *variant = &g_array_index(variants, HlsVariant, first);
+
+		if (variant->bandwidth <= (guint64) max_bitrate * 1000)
+			break;
 	}
 
-	g_strfreev(lines);
+	for (i = 0; i < first; i++)
+		list = g_slist_prepend(list, g_array_index(variants, HlsVariant, i).uri);
+
+	for (i = variants->len; i > first; i--)
+		list = g_slist_prepend(list, g_array_index(variants, HlsVariant, i - 1).uri);
+
+	DEBUG("HLS master playlist, %u variants, max bitrate: %u kbps",
+	      variants->len, max_bitrate);
+
+	g_array_free(variants, TRUE);
+
 	return list;
 }
 
 /* Parse a PLS playlist, which is a "Desktop Entry File" in the Unix world,
  * or an "INI File" in the windows realm.
  * https://en.wikipedia.org/wiki/PLS_(file_format)
+ *
+ * We only care about the `FileN=` and `TitleN=` entries of the `[playlist]`
+ * section, ordered by their number, up to `NumberOfEntries` when it's given.
+ */
+
+typedef struct {
+	guint  index;
+	gchar *uri;
+} PlsEntry;
+
+static gint
+pls_entry_cmp(gconstpointer a, gconstpointer b)
+{
+	const PlsEntry *ea = a;
+	const PlsEntry *eb = b;
+
+	return ea->index < eb->index ? -1 : ea->index > eb->index;
+}
+
+static gboolean
+pls_key_matches(const gchar *line, gsize line_len, const gchar *key,
+                const gchar **value)
+{
+	gsize key_len = strlen(key);
+
+	if (line_len <= key_len || g_ascii_strncasecmp(line, key, key_len))
+		return FALSE;
+
+	*value = line + key_len;
+	return TRUE;
+}
+
+/* Parse the `N=value` part of a numbered entry. The value is returned
+ * newly allocated, NULL if there's none.
  */
 
+static gchar *
+pls_get_numbered_value(const gchar *text, const gchar *end, guint *index)
+{
+	gchar *num_end;
+	const gchar *eq;
+
+	if (!g_ascii_isdigit(*text))
+		return NULL;
+
+	*index = g_ascii_strtoull(text, &num_end, 10);
+	eq = num_end;
+	while (eq < end && (*eq == ' ' || *eq == '\t'))
+		eq++;
+	if (eq >= end || *eq != '=')
+		return NULL;
+
+	eq++;
+	while (eq < end && (*eq == ' ' || *eq == '\t'))
+		eq++;
+	if (eq == end)
+		return NULL;
+
+	return g_strndup(eq, end - eq);
+}
+
 static GSList *
-parse_playlist_pls(const gchar *text, gsize text_size)
+parse_playlist_pls(const gchar *text, gsize text_size, GSList **titles)
 {
+	const gchar *end = text + text_size;
+	const gchar *line;
+	gsize line_len;
+	gboolean in_playlist = FALSE;
+	guint n_items = G_MAXUINT;
 	GSList *list = NULL;
-	GKeyFile *keyfile;
-	GError *err = NULL;
-	gint i, n_items;
-	const gchar *n_items_key;
+	GHashTable *entry_titles;
+	GArray *entries;
+	const gchar *title;
+	guint i;
 
-	keyfile = g_key_file_new();
+	entries = g_array_new(FALSE, FALSE, sizeof(PlsEntry));
+	entry_titles = g_hash_table_new_full(g_direct_hash, g_direct_equal, NULL, g_free);
 
-	/* Parse the file */
-	g_key_file_load_from_data(keyfile, text, text_size, 0, &err);
-	if (err) {
-		WARNING("Failed to parse pls playlist: %s", err->message);
-		g_error_free(err);
-		goto end;
-	}
+	while (next_line(&text, end, &line, &line_len)) {
+		const gchar *line_end = line + line_len;
+		const gchar *value;
+		PlsEntry entry;
+		gchar *entry_title;
+		guint index;
 
-	/* Get the number of items */
-	if (g_key_file_has_key(keyfile, "playlist", "NumberOfEntries", NULL)) {
-		n_items_key = "NumberOfEntries";
-	} else if (g_key_file_has_key(keyfile, "playlist", "NumberOfEvents", NULL)) {
-		n_items_key = "NumberOfEvents";
-	} else {
-		WARNING("Failed to get the nunmber of items in pls playlist");
-		goto end;
-	}
+		if (line_len == 0 || line[0] == ';' || line[0] == '#')
+			continue;
 
-	n_items = g_key_file_get_integer(keyfile, "playlist", n_items_key, &err);
-	if (err) {
-		WARNING("Failed to get key '%s': %s", n_items_key, err->message);
-		g_error_free(err);
-		goto end;
+		/* Section header */
+		if (line[0] == '[') {
+			in_playlist = line_len == 10 &&
+			              !g_ascii_strncasecmp(line, "[playlist]", 10);
+			continue;
+		}
+
+		if (!in_playlist)
+			continue;
+
+		/* Number of items */
+		if (pls_key_matches(line, line_len, "NumberOfEntries=", &value) ||
+		    pls_key_matches(line, line_len, "NumberOfEvents=", &value)) {
+			n_items = g_ascii_strtoull(value, NULL, 10);
+			continue;
+		}
+
+		/* Stream title, it might come before or after the uri */
+		if (pls_key_matches(line, line_len, "Title", &value)) {
+			entry_title = pls_get_numbered_value(value, line_end, &index);
+			if (entry_title)
+				g_hash_table_replace(entry_titles, GUINT_TO_POINTER(index),
+				                     entry_title);
+			continue;
+		}
+
+		/* Stream uri */
+		if (!pls_key_matches(line, line_len, "File", &value))
+			continue;
+
+		entry.uri = pls_get_numbered_value(value, line_end, &entry.index);
+		if (entry.uri)
+			g_array_append_val(entries, entry);
 	}
 
-	/* Get all stream uris */
-	for (i = 1; i <= n_items; i++) {
-		gchar key[8];
-		gchar *str;
+	/* Entries are usually in order already */
+	g_array_sort(entries, pls_entry_cmp);
 
-		g_snprintf(key, sizeof key, "File%d", i);
+	for (i = entries->len; i > 0; i--) {
+		PlsEntry *entry = &g_array_index(entries, PlsEntry, i - 1);
 
-		str = g_key_file_get_string(keyfile, "playlist", key, &err);
-		if (err) {
-			WARNING("Failed to get '%s': %s", key, err->message);
-			g_error_free(err);
-			err = NULL;
+		/* No need to duplicate the uri, it's already allocated */
+		if (entry->index < 1 || entry->index > n_items) {
+			g_free(entry->uri);
 			continue;
 		}
 
-		/* Add to stream list.
-		 * No need to duplicate str, it's already an allocated string.
-		 */
-		list = g_slist_append(list, str);
+		list = g_slist_prepend(list, entry->uri);
+
+		if (titles) {
+			title = g_hash_table_lookup(entry_titles, GUINT_TO_POINTER(entry->index));
+			*titles = g_slist_prepend(*titles, g_strdup(title));
+		}
 	}
 
-end:
-	g_key_file_free(keyfile);
+	g_hash_table_destroy(entry_titles);
+	g_array_free(entries, TRUE);
 
 	return list;
 }
@@ -248,9 +567,9 @@ asx_parse_element_cb(GMarkupParseContext *context G_GNUC_UNUSED,
 		}
 	}
 
-	/* Add to stream list */
+	/* Add to stream list, it's reversed at the end */
 	if (href)
-		*llink = g_slist_append(*llink, g_strdup(href));
+		*llink = g_slist_prepend(*llink, g_strdup(href));
 }
 
 static void
@@ -265,7 +584,7 @@ asx_error_cb(GMarkupParseContext *context G_GNUC_UNUSED,
 }
 
 static GSList *
-parse_playlist_asx(const gchar *text, gsize text_size)
+parse_playlist_asx(const gchar *text, gsize text_size, GSList **titles G_GNUC_UNUSED)
 {
 	GMarkupParseContext *context;
 	GMarkupParser parser = {
@@ -287,7 +606,7 @@ parse_playlist_asx(const gchar *text, gsize text_size)
 
 	g_markup_parse_context_free(context);
 
-	return list;
+	return g_slist_reverse(list);
 }
 
 /* Parse an XSPF (XML Shareable Playlist Format) playlist.
@@ -297,7 +616,7 @@ parse_playlist_asx(const gchar *text, gsize text_size)
 static void
 xspf_text_cb(GMarkupParseContext  *context,
              const gchar          *text,
-             gsize                 text_len G_GNUC_UNUSED,
+             gsize                 text_len,
              gpointer              user_data,
              GError              **error G_GNUC_UNUSED)
 {
@@ -310,8 +629,8 @@ xspf_text_cb(GMarkupParseContext  *context,
 	if (g_ascii_strcasecmp(element_name, "location"))
 		return;
 
-	/* Add to stream list */
-	*llink = g_slist_append(*llink, g_strdup(text));
+	/* Add to stream list, it's reversed at the end */
+	*llink = g_slist_prepend(*llink, g_strstrip(g_strndup(text, text_len)));
 }
 
 static void
@@ -326,7 +645,7 @@ xspf_error_cb(GMarkupParseContext *context G_GNUC_UNUSED,
 }
 
 static GSList *
-parse_playlist_xspf(const gchar *text, gsize text_size)
+parse_playlist_xspf(const gchar *text, gsize text_size, GSList **titles G_GNUC_UNUSED)
 {
 	GMarkupParseContext *context;
 	GMarkupParser parser = {
@@ -348,138 +667,912 @@ parse_playlist_xspf(const gchar *text, gsize text_size)
 
 	g_markup_parse_context_free(context);
 
-	return list;
+	return g_slist_reverse(list);
 }
 
 /*
- * Signal handlers & callbacks
+ * Content sniffing
  */
 
-static void
-on_message_completed(SoupSession *session,
-                     SoupMessage *msg,
-                     GvPlaylist *self)
+/* When the uri doesn't tell, the format is guessed from the Content-Type
+ * header, or from the first bytes of the content. If it's not a playlist,
+ * then it's a stream, and we stop downloading right away.
+ */
+
+#define SNIFF_SIZE        1024
+#define READ_SIZE         4096
+#define MAX_PLAYLIST_SIZE (256 * 1024)
+
+/* A download that takes longer than that is given up */
+#define DOWNLOAD_DEADLINE 20
+
+/* Playlists might point to other playlists, up to a point */
+#define MAX_DEPTH 4
+
+static GvPlaylistFormat
+sniff_content_type(const gchar *content_type, gboolean *is_stream)
 {
-	GvPlaylistPrivate *priv = self->priv;
-	PlaylistParser parser;
-	GSList *item;
+	static const gchar *m3u_types[] = {
+		"audio/x-mpegurl", "audio/mpegurl", "application/x-mpegurl",
+		"application/vnd.apple.mpegurl", NULL
+	};
+	static const gchar *pls_types[] = {
+		"audio/x-scpls", "application/pls+xml", NULL
+	};
+	static const gchar *asx_types[] = {
+		"video/x-ms-asx", "audio/x-ms-asx", "video/x-ms-wax", "audio/x-ms-wax", NULL
+	};
+	static const gchar *xspf_types[] = {
+		"application/xspf+xml", NULL
+	};
+	guint i;
 
-	TRACE("%p, %p, %p", session, msg, self);
+	*is_stream = FALSE;
 
-	/* Check the response */
-	if (!SOUP_STATUS_IS_SUCCESSFUL(msg->status_code)) {
-		WARNING("Failed to download playlist: %s", msg->reason_phrase);
-		goto end;
-	}
+	if (content_type == NULL)
+		return GV_PLAYLIST_FORMAT_UNKNOWN;
 
-	if (msg->response_body->length == 0) {
-		WARNING("Empty playlist");
-		goto end;
-	}
+	for (i = 0; m3u_types[i]; i++)
+		if (!g_ascii_strcasecmp(content_type, m3u_types[i]))
+			return GV_PLAYLIST_FORMAT_M3U;
 
-	//PRINT("%s", msg->response_body->data);
+	for (i = 0; pls_types[i]; i++)
+		if (!g_ascii_strcasecmp(content_type, pls_types[i]))
+			return GV_PLAYLIST_FORMAT_PLS;
 
-	/* Get the right parser */
-	switch (priv->format) {
-	case GV_PLAYLIST_FORMAT_M3U:
-		parser = parse_playlist_m3u;
-		break;
-	case GV_PLAYLIST_FORMAT_PLS:
-		parser = parse_playlist_pls;
-		break;
-	case GV_PLAYLIST_FORMAT_ASX:
-		parser = parse_playlist_asx;
-		break;
-	case GV_PLAYLIST_FORMAT_XSPF:
-		parser = parse_playlist_xspf;
-		break;
-	default:
-		WARNING("No parser for playlist format: %d", priv->format);
-		goto end;
-	}
+	for (i = 0; asx_types[i]; i++)
+		if (!g_ascii_strcasecmp(content_type, asx_types[i]))
+			return GV_PLAYLIST_FORMAT_ASX;
 
-	/* Parse */
-	if (priv->streams)
-		g_slist_free_full(priv->streams, g_free);
+	for (i = 0; xspf_types[i]; i++)
+		if (!g_ascii_strcasecmp(content_type, xspf_types[i]))
+			return GV_PLAYLIST_FORMAT_XSPF;
 
-	priv->streams = parser(msg->response_body->data, msg->response_body->length);
+	/* Any other audio type is a stream */
+	if (!g_ascii_strncasecmp(content_type, "audio/", 6) ||
+	    !g_ascii_strcasecmp(content_type, "application/ogg"))
+		*is_stream = TRUE;
 
-	/* Was it parsed successfully ? */
-	if (priv->streams == NULL) {
-		WARNING("Faild to parse playlist");
-		goto end;
+	return GV_PLAYLIST_FORMAT_UNKNOWN;
+}
+
+static gboolean
+has_prefix_nocase(const gchar *data, gsize size, const gchar *prefix)
+{
+	gsize len = strlen(prefix);
+
+	return size >= len && !g_ascii_strncasecmp(data, prefix, len);
+}
+
+static GvPlaylistFormat
+sniff_data(const gchar *data, gsize size)
+{
+	/* Skip UTF-8 BOM and leading blanks */
+	if (has_prefix_nocase(data, size, "\xef\xbb\xbf")) {
+		data += 3;
+		size -= 3;
+	}
+
+	while (size > 0 && g_ascii_isspace(*data)) {
+		data++;
+		size--;
 	}
 
-	DEBUG("Playlist parsed, %d streams found",
-	      g_slist_length(priv->streams));
+	if (has_prefix_nocase(data, size, "#EXTM3U"))
+		return GV_PLAYLIST_FORMAT_M3U;
+
+	if (has_prefix_nocase(data, size, "[playlist]"))
+		return GV_PLAYLIST_FORMAT_PLS;
 
-	for (item = priv->streams; item; item = item->next) {
-		DEBUG(". %s", item->data);
+	if (has_prefix_nocase(data, size, "<asx"))
+		return GV_PLAYLIST_FORMAT_ASX;
+
+	if (has_prefix_nocase(data, size, "<?xml")) {
+		if (g_strstr_len(data, size, "<playlist"))
+			return GV_PLAYLIST_FORMAT_XSPF;
+		if (g_strstr_len(data, size, "<asx") || g_strstr_len(data, size, "<ASX"))
+			return GV_PLAYLIST_FORMAT_ASX;
 	}
 
+	/* A plain list of uris */
+	if (has_prefix_nocase(data, size, "http://") ||
+	    has_prefix_nocase(data, size, "https://"))
+		return GV_PLAYLIST_FORMAT_M3U;
 
-end:
-	// TODO Is it ok to unref that here ?
-	g_object_unref(session);
+	return GV_PLAYLIST_FORMAT_UNKNOWN;
+}
 
-	/* msg needs not to be unreferenced. According to the doc,
-	 * it's consumed when using the queue() API.
-	 */
+static GvPlaylistFormat
+sniff_format(SoupMessage *msg, const gchar *data, gsize size)
+{
+	const gchar *content_type;
+	GvPlaylistFormat format;
+	gboolean is_stream;
 
-	/* Emit completion signal */
-	g_signal_emit(self, signals[SIGNAL_DOWNLOADED], 0);
+	content_type = soup_message_headers_get_content_type(msg->response_headers, NULL);
+
+	format = sniff_content_type(content_type, &is_stream);
+	if (format != GV_PLAYLIST_FORMAT_UNKNOWN || is_stream)
+		return format;
+
+	return sniff_data(data, size);
 }
 
 /*
- * Property accessors
+ * Playlist cache
  */
 
-const gchar *
-gv_playlist_get_uri(GvPlaylist *self)
-{
-	return self->priv->uri;
-}
+/* Resolved playlists are cached on disk, along with the http validators.
+ * An entry younger than the TTL is used as is. An older entry is used as
+ * well, but it's revalidated in the background with a conditional request.
+ */
 
-static void
-gv_playlist_set_uri(GvPlaylist *self, const gchar *uri)
+#define PLAYLIST_CACHE_TTL 3600
+
+/* Changes are written after a delay, so that a burst of downloads ends up
+ * in a single write. Writes happen in a worker thread. Entries that were
+ * not used for a while are dropped, and so are the oldest ones when
+ * there are too many.
+ */
+
+#define PLAYLIST_CACHE_SAVE_DELAY  10     // seconds
+#define PLAYLIST_CACHE_MAX_AGE     604800 // seconds
+#define PLAYLIST_CACHE_MAX_ENTRIES 1000
+
+static GKeyFile   *playlist_cache;
+static guint       playlist_cache_save_source_id;
+static gboolean    playlist_cache_writing;
+static GHashTable *playlist_pending;
+
+/* The write in the worker thread, so that the last write on exit can wait
+ * for it, rather than being overwritten with older data.
+ */
+static GMutex      playlist_cache_write_mutex;
+static GCond       playlist_cache_write_cond;
+static gboolean    playlist_cache_write_busy;
+
+static const gchar *
+playlist_cache_path(void)
 {
-	GvPlaylistPrivate *priv = self->priv;
+	static gchar *path;
 
-	/* This is a construct-only property */
-	g_assert_null(priv->uri);
-	g_assert_nonnull(uri);
-	priv->uri = g_strdup(uri);
+	if (path == NULL)
+		path = g_build_filename(gv_get_user_cache_dir(), "playlists.cache", NULL);
 
-	/* Set format */
-	priv->format = gv_playlist_get_format(uri);
+	return path;
 }
 
-GSList *
-gv_playlist_get_stream_list(GvPlaylist *self)
+/* Uris can't be used as group names, hence the checksum */
+static gchar *
+playlist_cache_group(const gchar *uri)
 {
-	return self->priv->streams;
+	return g_compute_checksum_for_string(G_CHECKSUM_SHA1, uri, -1);
 }
 
-static void
-gv_playlist_get_property(GObject    *object,
-                         guint       property_id,
-                         GValue     *value,
-                         GParamSpec *pspec)
+static GKeyFile *
+playlist_cache_get(void)
 {
-	GvPlaylist *self = GV_PLAYLIST(object);
+	GError *err = NULL;
 
-	TRACE_GET_PROPERTY(object, property_id, value, pspec);
+	if (playlist_cache)
+		return playlist_cache;
 
-	switch (property_id) {
-	case PROP_URI:
-		g_value_set_string(value, gv_playlist_get_uri(self));
-		break;
-	case PROP_STREAM_LIST:
-		g_value_set_pointer(value, gv_playlist_get_stream_list(self));
-		break;
-	default:
-		G_OBJECT_WARN_INVALID_PROPERTY_ID(object, property_id, pspec);
-		break;
+	playlist_cache = g_key_file_new();
+	if (!g_key_file_load_from_file(playlist_cache, playlist_cache_path(),
+	                               G_KEY_FILE_NONE, &err)) {
+		if (!g_error_matches(err, G_FILE_ERROR, G_FILE_ERROR_NOENT))
+			WARNING("Failed to load playlist cache: %s", err->message);
+		g_error_free(err);
+	}
+
+	return playlist_cache;
+}
+
+typedef struct {
+	gchar  *group;
+	gint64  timestamp;
+} PlaylistCacheEntry;
+
+static gint
+playlist_cache_entry_cmp(const PlaylistCacheEntry *a, const PlaylistCacheEntry *b)
+{
+	/* Most recent first */
+	return a->timestamp < b->timestamp ? 1 : a->timestamp > b->timestamp ? -1 : 0;
+}
+
+static void
+playlist_cache_prune(void)
+{
+	GKeyFile *cache = playlist_cache;
+	GArray *entries;
+	gchar **groups;
+	gsize n_groups;
+	gint64 now;
+	guint i;
+
+	now = g_get_real_time() / G_USEC_PER_SEC;
+	groups = g_key_file_get_groups(cache, &n_groups);
+	entries = g_array_sized_new(FALSE, FALSE, sizeof(PlaylistCacheEntry), n_groups);
+
+	for (i = 0; i < n_groups; i++) {
+		PlaylistCacheEntry entry;
+
+		entry.group = groups[i];
+		entry.timestamp = g_key_file_get_int64(cache, groups[i], "timestamp", NULL);
+
+		if (now - entry.timestamp > PLAYLIST_CACHE_MAX_AGE)
+			g_key_file_remove_group(cache, groups[i], NULL);
+		else
+			g_array_append_val(entries, entry);
+	}
+
+	if (entries->len > PLAYLIST_CACHE_MAX_ENTRIES) {
+		g_array_sort(entries, (GCompareFunc) playlist_cache_entry_cmp);
+		for (i = PLAYLIST_CACHE_MAX_ENTRIES; i < entries->len; i++) {
+			PlaylistCacheEntry *entry;
+
+			entry = &g_array_index(entries, PlaylistCacheEntry, i);
+			g_key_file_remove_group(cache, entry->group, NULL);
+		}
+	}
+
+	if (entries->len != n_groups || entries->len > PLAYLIST_CACHE_MAX_ENTRIES)
+		DEBUG("Playlist cache pruned, %u entries left",
+		      MIN(entries->len, PLAYLIST_CACHE_MAX_ENTRIES));
+
+	g_array_free(entries, TRUE);
+	g_strfreev(groups);
+}
+
+static void
+playlist_cache_write_thread(GTask        *task,
+                            gpointer      source_object G_GNUC_UNUSED,
+                            gpointer      task_data,
+                            GCancellable *cancellable G_GNUC_UNUSED)
+{
+	const gchar *text = task_data;
+	GError *err = NULL;
+
+	gboolean written;
+
+	written = gv_file_write_sync(playlist_cache_path(), text, &err);
+
+	g_mutex_lock(&playlist_cache_write_mutex);
+	playlist_cache_write_busy = FALSE;
+	g_cond_signal(&playlist_cache_write_cond);
+	g_mutex_unlock(&playlist_cache_write_mutex);
+
+	if (written)
+		g_task_return_boolean(task, TRUE);
+	else
+		g_task_return_error(task, err);
+}
+
+static void
+on_playlist_cache_written(GObject      *source_object G_GNUC_UNUSED,
+                          GAsyncResult *result,
+                          gpointer      data G_GNUC_UNUSED)
+{
+	GError *err = NULL;
+
+	playlist_cache_writing = FALSE;
+
+	if (!g_task_propagate_boolean(G_TASK(result), &err)) {
+		WARNING("Failed to save playlist cache: %s", err->message);
+		g_error_free(err);
+	}
+}
+
+static gboolean
+when_timeout_save_playlist_cache(gpointer data G_GNUC_UNUSED)
+{
+	GTask *task;
+	gchar *text;
+
+	/* One write at a time, try again later */
+	if (playlist_cache_writing)
+		return G_SOURCE_CONTINUE;
+
+	playlist_cache_save_source_id = 0;
+
+	playlist_cache_prune();
+	text = g_key_file_to_data(playlist_cache, NULL, NULL);
+
+	/* The path is computed here, the thread only reads it */
+	playlist_cache_path();
+
+	playlist_cache_writing = TRUE;
+	g_mutex_lock(&playlist_cache_write_mutex);
+	playlist_cache_write_busy = TRUE;
+	g_mutex_unlock(&playlist_cache_write_mutex);
+
+	task = g_task_new(NULL, NULL, on_playlist_cache_written, NULL);
+	g_task_set_task_data(task, text, g_free);
+	g_task_run_in_thread(task, playlist_cache_write_thread);
+	g_object_unref(task);
+
+	return G_SOURCE_REMOVE;
+}
+
+static void
+playlist_cache_save(void)
+{
+	if (playlist_cache_save_source_id)
+		return;
+
+	playlist_cache_save_source_id = g_timeout_add_seconds
+	                                (PLAYLIST_CACHE_SAVE_DELAY,
+	                                 when_timeout_save_playlist_cache, NULL);
+}
+
+static GSList *
+playlist_cache_lookup(const gchar *uri, gchar **etag, gchar **last_modified,
+                      gboolean *fresh)
+{
+	GKeyFile *cache = playlist_cache_get();
+	GSList *streams = NULL;
+	gchar **strv;
+	gchar *group;
+	gint64 age;
+	guint i;
+
+	group = playlist_cache_group(uri);
+
+	strv = g_key_file_get_string_list(cache, group, "streams", NULL, NULL);
+	if (strv == NULL)
+		goto end;
+
+	for (i = 0; strv[i]; i++)
+		streams = g_slist_prepend(streams, strv[i]);
+	streams = g_slist_reverse(streams);
+	g_free(strv);
+
+	age = g_get_real_time() / G_USEC_PER_SEC -
+	      g_key_file_get_int64(cache, group, "timestamp", NULL);
+
+	*etag = g_key_file_get_string(cache, group, "etag", NULL);
+	*last_modified = g_key_file_get_string(cache, group, "last-modified", NULL);
+	*fresh = age >= 0 && age < PLAYLIST_CACHE_TTL;
+
+end:
+	g_free(group);
+
+	return streams;
+}
+
+static void
+playlist_cache_touch(const gchar *uri)
+{
+	gchar *group;
+
+	group = playlist_cache_group(uri);
+	g_key_file_set_int64(playlist_cache_get(), group, "timestamp",
+	                     g_get_real_time() / G_USEC_PER_SEC);
+	g_free(group);
+
+	playlist_cache_save();
+}
+
+static void
+playlist_cache_store(const gchar *uri, GSList *streams,
+                     const gchar *etag, const gchar *last_modified)
+{
+	GKeyFile *cache = playlist_cache_get();
+	GPtrArray *strv;
+	gchar *group;
+	GSList *item;
+
+	group = playlist_cache_group(uri);
+
+	/* Start from a clean group, to drop outdated validators */
+	g_key_file_remove_group(cache, group, NULL);
+
+	strv = g_ptr_array_new();
+	for (item = streams; item; item = item->next)
+		g_ptr_array_add(strv, item->data);
+
+	g_key_file_set_string(cache, group, "uri", uri);
+	g_key_file_set_string_list(cache, group, "streams",
+	                           (const gchar * const *) strv->pdata, strv->len);
+	if (etag)
+		g_key_file_set_string(cache, group, "etag", etag);
+	if (last_modified)
+		g_key_file_set_string(cache, group, "last-modified", last_modified);
+
+	g_ptr_array_free(strv, TRUE);
+	g_free(group);
+
+	playlist_cache_touch(uri);
+}
+
+/*
+ * Private methods
+ */
+
+static void on_child_downloaded(GvPlaylist *child, GvPlaylist *self);
+
+/* Playlists that waited for this download get the same result */
+static void
+gv_playlist_release_waiters(GvPlaylist *self)
+{
+	GvPlaylistPrivate *priv = self->priv;
+	GSList *waiters = priv->waiters;
+	GSList *item;
+
+	priv->waiters = NULL;
+
+	for (item = waiters; item; item = item->next) {
+		GvPlaylist *waiter = item->data;
+		GvPlaylistPrivate *wpriv = waiter->priv;
+
+		wpriv->leader = NULL;
+		wpriv->downloading = FALSE;
+
+		if (priv->streams) {
+			if (wpriv->streams)
+				g_slist_free_full(wpriv->streams, g_free);
+			wpriv->streams = g_slist_copy_deep(priv->streams, (GCopyFunc) g_strdup, NULL);
+		}
+
+		g_signal_emit(waiter, signals[SIGNAL_DOWNLOADED], 0);
+		g_object_unref(waiter);
+	}
+
+	g_slist_free(waiters);
+}
+
+static void
+gv_playlist_download_done(GvPlaylist *self, GSList *streams)
+{
+	GvPlaylistPrivate *priv = self->priv;
+	gboolean cancelled;
+	GSList *item;
+
+	priv->downloading = FALSE;
+
+	/* Forget about this download, unless another one took over */
+	if (g_hash_table_lookup(playlist_pending, priv->uri) == self)
+		g_hash_table_remove(playlist_pending, priv->uri);
+
+	if (priv->deadline_id) {
+		g_source_remove(priv->deadline_id);
+		priv->deadline_id = 0;
+	}
+
+	if (streams) {
+		DEBUG("Playlist resolved, %d streams found",
+		      g_slist_length(streams));
+
+		for (item = streams; item; item = item->next) {
+			DEBUG(". %s", item->data);
+		}
+
+		/* Replace any streams that came from the cache */
+		if (priv->streams)
+			g_slist_free_full(priv->streams, g_free);
+
+		priv->streams = streams;
+
+		playlist_cache_store(priv->uri, streams, priv->etag, priv->last_modified);
+	}
+
+	g_clear_pointer(&priv->etag, g_free);
+	g_clear_pointer(&priv->last_modified, g_free);
+	g_clear_pointer(&priv->user_agent, g_free);
+
+	cancelled = g_cancellable_is_cancelled(priv->cancellable) || priv->orphaned;
+	g_clear_object(&priv->cancellable);
+	priv->orphaned = FALSE;
+
+	gv_playlist_release_waiters(self);
+
+	/* Emit completion signal, unless nobody wants the result anymore */
+	if (!cancelled)
+		g_signal_emit(self, signals[SIGNAL_DOWNLOADED], 0);
+
+	/* Release the reference taken for the download */
+	g_object_unref(self);
+}
+
+/* Children still downloading keep going on their own, to refresh their
+ * cache entry, unless they're cancelled.
+ */
+
+static void
+gv_playlist_clear_nested(GvPlaylist *self, gboolean cancel)
+{
+	GvPlaylistPrivate *priv = self->priv;
+	guint i;
+
+	if (priv->children == NULL)
+		return;
+
+	for (i = 0; i < priv->children->len; i++) {
+		GvPlaylist *child = g_ptr_array_index(priv->children, i);
+
+		if (child == NULL)
+			continue;
+
+		g_signal_handlers_disconnect_by_data(child, self);
+		if (cancel)
+			gv_playlist_cancel(child);
+		g_object_unref(child);
+	}
+
+	g_clear_pointer(&priv->children, g_ptr_array_unref);
+	g_slist_free_full(priv->nested_uris, g_free);
+	priv->nested_uris = NULL;
+	priv->n_children_pending = 0;
+}
+
+/* Once every nested playlist is resolved, replace each of them
+ * by its streams, keeping the order.
+ */
+
+static void
+gv_playlist_nested_done(GvPlaylist *self)
+{
+	GvPlaylistPrivate *priv = self->priv;
+	GSList *streams = NULL;
+	GSList *item;
+	guint i;
+
+	for (item = priv->nested_uris, i = 0; item; item = item->next, i++) {
+		GvPlaylist *child = g_ptr_array_index(priv->children, i);
+		GSList *child_item;
+
+		if (child == NULL) {
+			streams = g_slist_prepend(streams, g_strdup(item->data));
+			continue;
+		}
+
+		for (child_item = gv_playlist_get_stream_list(child); child_item;
+		     child_item = child_item->next)
+			streams = g_slist_prepend(streams, g_strdup(child_item->data));
+	}
+
+	gv_playlist_clear_nested(self, FALSE);
+
+	gv_playlist_download_done(self, g_slist_reverse(streams));
+}
+
+/* Start resolving the stream uris that are playlists themselves. Each
+ * nested playlist is downloaded concurrently, and cached on its own.
+ */
+
+static void
+gv_playlist_resolve_nested(GvPlaylist *self, GSList *streams)
+{
+	GvPlaylistPrivate *priv = self->priv;
+	GHashTableIter iter;
+	gpointer ancestor;
+	GPtrArray *children;
+	GSList *uris = NULL;
+	GSList *item;
+	guint i;
+
+	children = g_ptr_array_new();
+
+	for (item = streams; item; item = item->next) {
+		gchar *uri = item->data;
+		GvPlaylist *child = NULL;
+
+		if (gv_playlist_get_format(uri) != GV_PLAYLIST_FORMAT_UNKNOWN) {
+			if (priv->depth >= MAX_DEPTH) {
+				WARNING("Too many nested playlists, ignoring '%s'", uri);
+				g_free(uri);
+				continue;
+			}
+
+			if (!g_strcmp0(uri, priv->uri) ||
+			    g_hash_table_contains(priv->ancestors, uri)) {
+				WARNING("Playlist loop detected, ignoring '%s'", uri);
+				g_free(uri);
+				continue;
+			}
+
+			child = gv_playlist_new(uri);
+			child->priv->depth = priv->depth + 1;
+			g_hash_table_add(child->priv->ancestors, g_strdup(priv->uri));
+			g_hash_table_iter_init(&iter, priv->ancestors);
+			while (g_hash_table_iter_next(&iter, &ancestor, NULL))
+				g_hash_table_add(child->priv->ancestors, g_strdup(ancestor));
+			priv->n_children_pending++;
+		}
+
+		uris = g_slist_prepend(uris, uri);
+		g_ptr_array_add(children, child);
+	}
+
+	g_slist_free(streams);
+	priv->nested_uris = g_slist_reverse(uris);
+	priv->children = children;
+
+	if (priv->n_children_pending == 0) {
+		gv_playlist_nested_done(self);
+		return;
+	}
+
+	/* Children might complete right away, from the cache */
+	g_object_ref(self);
+	g_ptr_array_ref(children);
+
+	for (i = 0; i < children->len; i++) {
+		GvPlaylist *child = g_ptr_array_index(children, i);
+
+		if (child == NULL)
+			continue;
+
+		g_signal_connect_object(child, "downloaded",
+		                        G_CALLBACK(on_child_downloaded), self, 0);
+		gv_playlist_download(child, priv->user_agent);
+	}
+
+	g_ptr_array_unref(children);
+	g_object_unref(self);
+}
+
+static void
+gv_playlist_download_finish(GvPlaylist *self, GSList *streams, gboolean nested)
+{
+	GvPlaylistPrivate *priv = self->priv;
+	SoupMessage *msg = priv->msg;
+
+	/* Closing the stream drops the connection, in case it's a radio */
+	if (priv->input) {
+		g_input_stream_close(priv->input, NULL, NULL);
+		g_clear_object(&priv->input);
+	}
+
+	if (priv->buffer) {
+		g_byte_array_unref(priv->buffer);
+		priv->buffer = NULL;
+	}
+
+	/* Keep the validators, the message is done */
+	priv->etag = g_strdup(soup_message_headers_get_one(msg->response_headers, "ETag"));
+	priv->last_modified = g_strdup(soup_message_headers_get_one(msg->response_headers,
+	                               "Last-Modified"));
+
+	priv->msg = NULL;
+	g_object_unref(msg);
+
+	if (streams && nested && !g_cancellable_is_cancelled(priv->cancellable))
+		gv_playlist_resolve_nested(self, streams);
+	else
+		gv_playlist_download_done(self, streams);
+}
+
+/*
+ * Signal handlers & callbacks
+ */
+
+static void
+on_child_downloaded(GvPlaylist *child,
+                    GvPlaylist *self)
+{
+	GvPlaylistPrivate *priv = self->priv;
+
+	/* A child might be notified twice, the first time is enough */
+	g_signal_handlers_disconnect_by_func(child, on_child_downloaded, self);
+
+	g_assert(priv->n_children_pending > 0);
+	priv->n_children_pending--;
+
+	if (priv->n_children_pending == 0)
+		gv_playlist_nested_done(self);
+}
+
+static gboolean
+when_timeout_give_up(gpointer data)
+{
+	GvPlaylist *self = GV_PLAYLIST(data);
+	GvPlaylistPrivate *priv = self->priv;
+
+	WARNING("Playlist download timed out: %s", priv->uri);
+
+	priv->deadline_id = 0;
+	priv->downloading = FALSE;
+	g_cancellable_cancel(priv->cancellable);
+
+	/* The download is not cancelled on behalf of the user, so there's
+	 * still someone waiting for the completion signal.
+	 */
+	gv_playlist_release_waiters(self);
+	if (!priv->orphaned)
+		g_signal_emit(self, signals[SIGNAL_DOWNLOADED], 0);
+
+	return G_SOURCE_REMOVE;
+}
+
+static void
+on_body_read(GObject      *source,
+             GAsyncResult *result,
+             gpointer      user_data)
+{
+	GvPlaylist *self = GV_PLAYLIST(user_data);
+	GvPlaylistPrivate *priv = self->priv;
+	GSList *streams = NULL;
+	gboolean nested = FALSE;
+	GError *err = NULL;
+	const gchar *text;
+	gsize text_size;
+	GBytes *bytes;
+	gsize size;
+
+	bytes = g_input_stream_read_bytes_finish(G_INPUT_STREAM(source), result, &err);
+	if (bytes == NULL) {
+		if (g_error_matches(err, G_IO_ERROR, G_IO_ERROR_CANCELLED))
+			DEBUG("Playlist download cancelled: %s", priv->uri);
+		else
+			WARNING("Failed to download playlist: %s", err->message);
+		g_error_free(err);
+		goto end;
+	}
+
+	size = g_bytes_get_size(bytes);
+	g_byte_array_append(priv->buffer, g_bytes_get_data(bytes, NULL), size);
+	g_bytes_unref(bytes);
+
+	/* Classify as soon as there's enough data */
+	if (priv->format == GV_PLAYLIST_FORMAT_UNKNOWN) {
+		if (size > 0 && priv->buffer->len < SNIFF_SIZE)
+			goto read_more;
+
+		priv->format = sniff_format(priv->msg, (const gchar *) priv->buffer->data,
+		                            priv->buffer->len);
+
+		if (priv->format == GV_PLAYLIST_FORMAT_UNKNOWN) {
+			DEBUG("Uri '%s' is a stream", priv->uri);
+			streams = g_slist_append(NULL, g_strdup(priv->uri));
+			goto end;
+		}
+
+		DEBUG("Uri '%s' is a playlist (format: %d)", priv->uri, priv->format);
+	}
+
+	/* Read the playlist until the end */
+	if (size > 0) {
+		if (priv->buffer->len < MAX_PLAYLIST_SIZE)
+			goto read_more;
+
+		WARNING("Playlist is too large");
+		goto end;
+	}
+
+	if (priv->buffer->len == 0) {
+		WARNING("Empty playlist");
+		goto end;
+	}
+
+	//PRINT("%s", priv->buffer->data);
+
+	/* Parsers expect a nul-terminated string */
+	g_byte_array_append(priv->buffer, (const guint8 *) "", 1);
+	text = (const gchar *) priv->buffer->data;
+	text_size = priv->buffer->len - 1;
+
+	/* HLS variants are streams, other playlists might be nested */
+	if (priv->format == GV_PLAYLIST_FORMAT_M3U && is_hls_playlist(text, text_size)) {
+		streams = parse_playlist_hls(priv->uri, text, text_size,
+		                             g_settings_get_uint(gv_core_settings, "max-bitrate"));
+	} else {
+		streams = gv_playlist_parse(priv->format, text, text_size, NULL);
+		nested = TRUE;
+	}
+
+	/* Was it parsed successfully ? */
+	if (streams == NULL)
+		WARNING("Faild to parse playlist");
+
+end:
+	gv_playlist_download_finish(self, streams, nested);
+	return;
+
+read_more:
+	g_input_stream_read_bytes_async(priv->input, READ_SIZE, G_PRIORITY_DEFAULT,
+	                                priv->cancellable, on_body_read, self);
+}
+
+static void
+on_message_sent(GObject      *source,
+                GAsyncResult *result,
+                gpointer      user_data)
+{
+	GvPlaylist *self = GV_PLAYLIST(user_data);
+	GvPlaylistPrivate *priv = self->priv;
+	SoupMessage *msg = priv->msg;
+	GError *err = NULL;
+
+	priv->input = soup_session_send_finish(SOUP_SESSION(source), result, &err);
+	if (priv->input == NULL) {
+		if (g_error_matches(err, G_IO_ERROR, G_IO_ERROR_CANCELLED))
+			DEBUG("Playlist download cancelled: %s", priv->uri);
+		else
+			WARNING("Failed to download playlist: %s", err->message);
+		g_error_free(err);
+		goto end;
+	}
+
+	/* Check the response */
+	if (msg->status_code == SOUP_STATUS_NOT_MODIFIED) {
+		DEBUG("Playlist not modified, cache revalidated");
+		playlist_cache_touch(priv->uri);
+		goto end;
+	}
+
+	if (!SOUP_STATUS_IS_SUCCESSFUL(msg->status_code)) {
+		WARNING("Failed to download playlist: %s", msg->reason_phrase);
+		goto end;
+	}
+
+	/* Read enough to find out what it is, if needed */
+	priv->buffer = g_byte_array_new();
+	g_input_stream_read_bytes_async(priv->input, SNIFF_SIZE, G_PRIORITY_DEFAULT,
+	                                priv->cancellable, on_body_read, self);
+	return;
+
+end:
+	gv_playlist_download_finish(self, NULL, FALSE);
+}
+
+/*
+ * Property accessors
+ */
+
+const gchar *
+gv_playlist_get_uri(GvPlaylist *self)
+{
+	return self->priv->uri;
+}
+
+/* Whether a download was started, and is not done or cancelled yet */
+gboolean
+gv_playlist_is_downloading(GvPlaylist *self)
+{
+	return self->priv->downloading;
+}
+
+static void
+gv_playlist_set_uri(GvPlaylist *self, const gchar *uri)
+{
+	GvPlaylistPrivate *priv = self->priv;
+
+	/* This is a construct-only property */
+	g_assert_null(priv->uri);
+	g_assert_nonnull(uri);
+	priv->uri = g_strdup(uri);
+
+	/* Set format */
+	priv->format = gv_playlist_get_format(uri);
+}
+
+GSList *
+gv_playlist_get_stream_list(GvPlaylist *self)
+{
+	return self->priv->streams;
+}
+
+static void
+gv_playlist_get_property(GObject    *object,
+                         guint       property_id,
+                         GValue     *value,
+                         GParamSpec *pspec)
+{
+	GvPlaylist *self = GV_PLAYLIST(object);
+
+	TRACE_GET_PROPERTY(object, property_id, value, pspec);
+
+	switch (property_id) {
+	case PROP_URI:
+		g_value_set_string(value, gv_playlist_get_uri(self));
+		break;
+	case PROP_STREAM_LIST:
+		g_value_set_pointer(value, gv_playlist_get_stream_list(self));
+		break;
+	default:
+		G_OBJECT_WARN_INVALID_PROPERTY_ID(object, property_id, pspec);
+		break;
 	}
 }
 
@@ -511,17 +1604,129 @@ void
 gv_playlist_download(GvPlaylist *self, const gchar *user_agent)
 {
 	GvPlaylistPrivate *priv = self->priv;
-	SoupSession *session;
+	GvPlaylist *pending;
 	SoupMessage *msg;
+	GSList *streams;
+	gchar *etag = NULL;
+	gchar *last_modified = NULL;
+	gboolean fresh = FALSE;
+
+	/* Signal handlers might drop the last reference, or cancel */
+	g_object_ref(self);
+	priv->downloading = TRUE;
+
+	/* Start with the cached streams, if any */
+	streams = playlist_cache_lookup(priv->uri, &etag, &last_modified, &fresh);
+	if (streams) {
+		DEBUG("Playlist '%s' found in cache (%s)", priv->uri,
+		      fresh ? "fresh" : "stale");
+
+		if (priv->streams)
+			g_slist_free_full(priv->streams, g_free);
+
+		priv->streams = streams;
+		if (fresh)
+			priv->downloading = FALSE;
+
+		g_signal_emit(self, signals[SIGNAL_DOWNLOADED], 0);
+
+		/* Fresh enough, or cancelled by a signal handler */
+		if (!priv->downloading)
+			goto end;
+	}
+
+	/* Don't download the same playlist twice at the same time */
+	if (playlist_pending == NULL)
+		playlist_pending = g_hash_table_new_full(g_str_hash, g_str_equal,
+		                                         g_free, NULL);
+
+	/* Nested playlists are not tracked, their parent is */
+	pending = priv->depth == 0 ? g_hash_table_lookup(playlist_pending, priv->uri) : NULL;
+	if (pending && !g_cancellable_is_cancelled(pending->priv->cancellable)) {
+		DEBUG("Playlist '%s' is already being downloaded, waiting for it", priv->uri);
+		priv->leader = pending;
+		pending->priv->waiters = g_slist_append(pending->priv->waiters, g_object_ref(self));
+		goto end;
+	}
 
 	DEBUG("Downloading playlist '%s' (user-agent: '%s')", priv->uri, user_agent);
-	session = soup_session_new_with_options(SOUP_SESSION_USER_AGENT, user_agent,
-	                                        NULL);
 	msg = soup_message_new("GET", priv->uri);
+	if (msg == NULL) {
+		WARNING("Failed to create message for uri '%s'", priv->uri);
+		priv->downloading = FALSE;
+		g_signal_emit(self, signals[SIGNAL_DOWNLOADED], 0);
+		goto end;
+	}
+
+	/* The session is shared, the user agent is set per message */
+	if (user_agent)
+		soup_message_headers_replace(msg->request_headers, "User-Agent", user_agent);
 
-	soup_session_queue_message(session, msg,
-	                           (SoupSessionCallback) on_message_completed,
-	                           self);
+	/* Conditional request if we have a cached copy */
+	if (etag)
+		soup_message_headers_replace(msg->request_headers, "If-None-Match", etag);
+	if (last_modified)
+		soup_message_headers_replace(msg->request_headers, "If-Modified-Since", last_modified);
+
+	/* Keep the playlist alive until the download completes. The body is
+	 * read by chunks, so that a stream can be told apart from a playlist
+	 * before downloading too much, in case the format is unknown.
+	 */
+	if (priv->depth == 0)
+		g_hash_table_replace(playlist_pending, g_strdup(priv->uri), self);
+	priv->user_agent = g_strdup(user_agent);
+	priv->msg = msg;
+	priv->cancellable = g_cancellable_new();
+	priv->deadline_id = g_timeout_add_seconds(DOWNLOAD_DEADLINE, when_timeout_give_up, self);
+	soup_session_send_async(gv_core_soup_session, msg, priv->cancellable,
+	                        on_message_sent, g_object_ref(self));
+
+end:
+	g_free(etag);
+	g_free(last_modified);
+	g_object_unref(self);
+}
+
+/* Cancel the download in progress, if any. The completion signal won't be
+ * emitted, and the streams, if any, are the ones from the cache.
+ */
+void
+gv_playlist_cancel(GvPlaylist *self)
+{
+	GvPlaylistPrivate *priv = self->priv;
+
+	priv->downloading = FALSE;
+
+	/* Waiting for another download, stop waiting */
+	if (priv->leader) {
+		GvPlaylistPrivate *lpriv = priv->leader->priv;
+
+		lpriv->waiters = g_slist_remove(lpriv->waiters, self);
+		priv->leader = NULL;
+		g_object_unref(self);
+		return;
+	}
+
+	if (priv->cancellable == NULL)
+		return;
+
+	/* Others wait for this download, let it complete for them */
+	if (priv->waiters) {
+		DEBUG("Playlist download still wanted by others: %s", priv->uri);
+		priv->orphaned = TRUE;
+		return;
+	}
+
+	DEBUG("Cancelling playlist download: %s", priv->uri);
+	g_cancellable_cancel(priv->cancellable);
+
+	/* If waiting for nested playlists, there's no pending operation
+	 * to complete the download, so it must be done here.
+	 */
+	if (priv->children) {
+		gv_playlist_clear_nested(self, TRUE);
+		gv_playlist_download_done(self, NULL);
+	}
 }
 
 GvPlaylist *
@@ -542,6 +1747,16 @@ gv_playlist_finalize(GObject *object)
 	TRACE("%p", object);
 
 	/* Free any allocated resources */
+	g_assert_null(priv->msg);
+	g_assert_null(priv->input);
+	g_assert_null(priv->children);
+	g_assert_null(priv->leader);
+	g_assert_null(priv->waiters);
+
+	if (priv->streams)
+		g_slist_free_full(priv->streams, g_free);
+
+	g_hash_table_destroy(priv->ancestors);
 	g_free(priv->uri);
 
 	/* Chain up */
@@ -570,6 +1785,9 @@ gv_playlist_init(GvPlaylist *self)
 
 	/* Initialize private pointer */
 	self->priv = gv_playlist_get_instance_private(self);
+
+	/* Initialize private data */
+	self->priv->ancestors = g_hash_table_new_full(g_str_hash, g_str_equal, g_free, NULL);
 }
 
 static void
@@ -609,6 +1827,138 @@ gv_playlist_class_init(GvPlaylistClass *class)
  * Class methods
  */
 
+/* Parse a playlist. If titles is not NULL, it's set to a list of the
+ * same length as the list returned, with the title of each stream, when
+ * the playlist gives one, NULL otherwise.
+ */
+GSList *
+gv_playlist_parse(GvPlaylistFormat format, const gchar *text, gsize text_size,
+                  GSList **titles)
+{
+	PlaylistParser parser;
+	GSList *list;
+
+	if (titles)
+		*titles = NULL;
+
+	/* Get the right parser */
+	switch (format) {
+	case GV_PLAYLIST_FORMAT_M3U:
+		parser = parse_playlist_m3u;
+		break;
+	case GV_PLAYLIST_FORMAT_PLS:
+		parser = parse_playlist_pls;
+		break;
+	case GV_PLAYLIST_FORMAT_ASX:
+		parser = parse_playlist_asx;
+		break;
+	case GV_PLAYLIST_FORMAT_XSPF:
+		parser = parse_playlist_xspf;
+		break;
+	default:
+		WARNING("No parser for playlist format: %d", format);
+		return NULL;
+	}
+
+	list = parser(text, text_size, titles);
+
+	/* Parsers that don't know about titles leave the list empty */
+	if (titles && *titles == NULL) {
+		guint n;
+
+		for (n = g_slist_length(list); n > 0; n--)
+			*titles = g_slist_prepend(*titles, NULL);
+	}
+
+	return list;
+}
+
+/* Whether the uri is known to be a stream, without downloading it */
+gboolean
+gv_playlist_is_stream_uri(const gchar *uri_string)
+{
+	static const gchar *stream_exts[] = {
+		"aac", "aacp", "flac", "m4a", "mp3", "mp4", "nsv",
+		"oga", "ogg", "opus", "spx", "wav", "wma", NULL
+	};
+	gboolean is_stream = FALSE;
+	const gchar *scheme;
+	const gchar *path;
+	const gchar *ext;
+	SoupURI *uri;
+	guint i;
+
+	if (gv_playlist_get_format(uri_string) != GV_PLAYLIST_FORMAT_UNKNOWN)
+		return FALSE;
+
+	uri = soup_uri_new(uri_string);
+	if (uri == NULL)
+		return TRUE;
+
+	/* Only http uris can be probed */
+	scheme = soup_uri_get_scheme(uri);
+	if (scheme != SOUP_URI_SCHEME_HTTP && scheme != SOUP_URI_SCHEME_HTTPS) {
+		is_stream = TRUE;
+		goto end;
+	}
+
+	/* Look at the extension of the last path segment */
+	path = soup_uri_get_path(uri);
+	ext = strrchr(path, '/');
+	ext = strrchr(ext ? ext : path, '.');
+	if (ext == NULL)
+		goto end;
+
+	for (i = 0; stream_exts[i]; i++) {
+		if (!g_ascii_strcasecmp(ext + 1, stream_exts[i])) {
+			is_stream = TRUE;
+			break;
+		}
+	}
+
+end:
+	soup_uri_free(uri);
+
+	return is_stream;
+}
+
+/* Number of playlist downloads in flight */
+guint
+gv_playlist_get_n_downloads(void)
+{
+	return playlist_pending ? g_hash_table_size(playlist_pending) : 0;
+}
+
+/* Write pending changes of the playlist cache now, on exit. A write that
+ * is queued or in progress in the worker thread is waited for first.
+ */
+void
+gv_playlist_flush_cache(void)
+{
+	GError *err = NULL;
+	gchar *text;
+
+	g_mutex_lock(&playlist_cache_write_mutex);
+	while (playlist_cache_write_busy)
+		g_cond_wait(&playlist_cache_write_cond, &playlist_cache_write_mutex);
+	g_mutex_unlock(&playlist_cache_write_mutex);
+
+	if (playlist_cache_save_source_id == 0)
+		return;
+
+	g_source_remove(playlist_cache_save_source_id);
+	playlist_cache_save_source_id = 0;
+
+	playlist_cache_prune();
+	text = g_key_file_to_data(playlist_cache, NULL, NULL);
+	if (!gv_file_write_sync(playlist_cache_path(), text, &err)) {
+		WARNING("Failed to save playlist cache: %s", err->message);
+		g_error_free(err);
+	}
+
+	g_free(text);
+}
+
 GvPlaylistFormat
 gv_playlist_get_format(const gchar *uri_string)
 {
@@ -43,15 +43,23 @@ typedef enum {
 /* Class methods */
 
 GvPlaylistFormat gv_playlist_get_format(const gchar *uri);
+GSList          *gv_playlist_parse     (GvPlaylistFormat format,
+                                        const gchar *text, gsize text_size,
+                                        GSList **titles);
+gboolean         gv_playlist_is_stream_uri(const gchar *uri);
+guint            gv_playlist_get_n_downloads(void);
+void             gv_playlist_flush_cache(void);
 
 /* Methods */
 
 GvPlaylist *gv_playlist_new     (const gchar *uri);
 void        gv_playlist_download(GvPlaylist *playlist, const gchar *user_agent);
+void        gv_playlist_cancel  (GvPlaylist *playlist);
 
 /* Property accessors */
 
 const gchar *gv_playlist_get_uri        (GvPlaylist *self);
+gboolean     gv_playlist_is_downloading (GvPlaylist *self);
 GSList      *gv_playlist_get_stream_list(GvPlaylist *playlist);
 
 #endif /* __GOODVIBES_CORE_GV_PLAYLIST_H__ */
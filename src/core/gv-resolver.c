@@ -0,0 +1,413 @@
+/*
+ * Goodvibes Radio Player
+ *
+ * Copyright (C) 2015-2017 Arnaud Rebillout
+ *
+ * SPDX-License-Identifier: GPL-3.0-or-later
+ *
+ * This program is free software: you can redistribute it and/or modify
+ * it under the terms of the GNU General Public License as published by
+ * the Free Software Foundation, either version 3 of the License, or
+ * (at your option) any later version.
+ *
+ * This program is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ * GNU General Public License for more details.
+ *
+ * You should have received a copy of the GNU General Public License
+ * along with this program. If not, see <http://www.gnu.org/licenses/>.
+ */
+
+/*
+ * The resolver walks the station list in the background, once it's loaded,
+ * and downloads the playlists of the stations whose stream uris are not known
+ * yet. This way, the first time a station is played, there's no need to wait
+ * for the playlist.
+ *
+ * Downloads are started one at a time, at a limited pace, and only while
+ * there are not too many downloads in flight. The resolver stays idle while
+ * the player is connecting or buffering, or when the network is unavailable.
+ */
+
+#include <glib.h>
+#include <glib-object.h>
+#include <gio/gio.h>
+
+#include "additions/glib-object.h"
+#include "framework/gv-framework.h"
+#include "core/gv-player.h"
+#include "core/gv-playlist.h"
+#include "core/gv-station.h"
+#include "core/gv-station-list.h"
+
+#include "core/gv-resolver.h"
+
+#define START_DELAY   5     /* seconds */
+#define INTERVAL      250   /* milliseconds */
+#define MAX_DOWNLOADS 4
+
+/*
+ * Properties
+ */
+
+enum {
+	/* Reserved */
+	PROP_0,
+	/* Construct-only properties */
+	PROP_PLAYER,
+	PROP_STATION_LIST,
+	/* Properties */
+	PROP_PAUSED,
+	/* Number of properties */
+	PROP_N
+};
+
+static GParamSpec *properties[PROP_N];
+
+/*
+ * GObject definitions
+ */
+
+struct _GvResolverPrivate {
+	/* Construct-only properties */
+	GvPlayer      *player;
+	GvStationList *station_list;
+	/* Properties */
+	gboolean       paused;
+	/* Stations waiting to be resolved */
+	GQueue        *queue;
+	guint          source_id;
+};
+
+typedef struct _GvResolverPrivate GvResolverPrivate;
+
+struct _GvResolver {
+	/* Parent instance structure */
+	GObject            parent_instance;
+	/* Private data */
+	GvResolverPrivate *priv;
+};
+
+G_DEFINE_TYPE_WITH_PRIVATE(GvResolver, gv_resolver, G_TYPE_OBJECT)
+
+/*
+ * Helpers
+ */
+
+static gboolean
+needs_resolving(GvStation *station)
+{
+	const gchar *uri = gv_station_get_uri(station);
+
+	if (gv_station_get_stream_uris(station))
+		return FALSE;
+
+	return !gv_playlist_is_stream_uri(uri);
+}
+
+/* The resolver gives way to anything that might need the network more */
+static gboolean
+is_system_busy(GvResolver *self)
+{
+	GvResolverPrivate *priv = self->priv;
+	GNetworkMonitor *monitor = g_network_monitor_get_default();
+
+	switch (gv_player_get_state(priv->player)) {
+	case GV_PLAYER_STATE_CONNECTING:
+	case GV_PLAYER_STATE_BUFFERING:
+		return TRUE;
+	default:
+		break;
+	}
+
+	if (!g_network_monitor_get_network_available(monitor))
+		return TRUE;
+
+	return FALSE;
+}
+
+/*
+ * Private methods
+ */
+
+static void
+gv_resolver_clear_queue(GvResolver *self)
+{
+	GvResolverPrivate *priv = self->priv;
+
+	if (priv->source_id) {
+		g_source_remove(priv->source_id);
+		priv->source_id = 0;
+	}
+
+	g_queue_free_full(priv->queue, g_object_unref);
+	priv->queue = g_queue_new();
+}
+
+static gboolean
+when_timeout_resolve_next(gpointer data)
+{
+	GvResolver *self = GV_RESOLVER(data);
+	GvResolverPrivate *priv = self->priv;
+	GvStation *station;
+
+	if (priv->paused || is_system_busy(self))
+		return G_SOURCE_CONTINUE;
+
+	if (gv_playlist_get_n_downloads() >= MAX_DOWNLOADS)
+		return G_SOURCE_CONTINUE;
+
+	/* Skip stations that were removed or resolved meanwhile */
+	while ((station = g_queue_pop_head(priv->queue))) {
+		if (gv_station_list_find(priv->station_list, station) &&
+		    needs_resolving(station))
+			break;
+
+		g_object_unref(station);
+	}
+
+	if (station == NULL) {
+		DEBUG("All playlists resolved");
+		priv->source_id = 0;
+		return G_SOURCE_REMOVE;
+	}
+
+	DEBUG("Resolving playlist of station '%s'", gv_station_get_name_or_uri(station));
+	gv_station_download_playlist(station);
+	g_object_unref(station);
+
+	return G_SOURCE_CONTINUE;
+}
+
+static gboolean
+when_timeout_start(gpointer data)
+{
+	GvResolver *self = GV_RESOLVER(data);
+	GvResolverPrivate *priv = self->priv;
+	GvStationListIter *iter;
+	GvStation *station;
+
+	/* Queue every station that needs resolving */
+	iter = gv_station_list_iter_new(priv->station_list);
+	while (gv_station_list_iter_loop(iter, &station)) {
+		if (needs_resolving(station))
+			g_queue_push_tail(priv->queue, g_object_ref(station));
+	}
+	gv_station_list_iter_free(iter);
+
+	DEBUG("%u playlists to resolve", g_queue_get_length(priv->queue));
+
+	priv->source_id = g_timeout_add(INTERVAL, when_timeout_resolve_next, self);
+
+	return G_SOURCE_REMOVE;
+}
+
+/*
+ * Signal handlers
+ */
+
+static void
+on_station_list_loaded(GvStationList *station_list G_GNUC_UNUSED,
+                       GvResolver    *self)
+{
+	GvResolverPrivate *priv = self->priv;
+
+	/* Start over, after a little while, to let the startup settle */
+	gv_resolver_clear_queue(self);
+	priv->source_id = g_timeout_add_seconds(START_DELAY, when_timeout_start, self);
+}
+
+/*
+ * Property accessors
+ */
+
+static void
+gv_resolver_set_player(GvResolver *self, GvPlayer *player)
+{
+	GvResolverPrivate *priv = self->priv;
+
+	/* This is a construct-only property */
+	g_assert_null(priv->player);
+	g_assert_nonnull(player);
+	priv->player = g_object_ref(player);
+}
+
+static void
+gv_resolver_set_station_list(GvResolver *self, GvStationList *station_list)
+{
+	GvResolverPrivate *priv = self->priv;
+
+	/* This is a construct-only property */
+	g_assert_null(priv->station_list);
+	g_assert_nonnull(station_list);
+	priv->station_list = g_object_ref(station_list);
+
+	g_signal_connect_object(station_list, "loaded",
+	                        G_CALLBACK(on_station_list_loaded), self, 0);
+}
+
+gboolean
+gv_resolver_get_paused(GvResolver *self)
+{
+	return self->priv->paused;
+}
+
+void
+gv_resolver_set_paused(GvResolver *self, gboolean paused)
+{
+	GvResolverPrivate *priv = self->priv;
+
+	if (priv->paused == paused)
+		return;
+
+	priv->paused = paused;
+	g_object_notify_by_pspec(G_OBJECT(self), properties[PROP_PAUSED]);
+}
+
+static void
+gv_resolver_get_property(GObject    *object,
+                         guint       property_id,
+                         GValue     *value,
+                         GParamSpec *pspec)
+{
+	GvResolver *self = GV_RESOLVER(object);
+
+	TRACE_GET_PROPERTY(object, property_id, value, pspec);
+
+	switch (property_id) {
+	case PROP_PAUSED:
+		g_value_set_boolean(value, gv_resolver_get_paused(self));
+		break;
+	default:
+		G_OBJECT_WARN_INVALID_PROPERTY_ID(object, property_id, pspec);
+		break;
+	}
+}
+
+static void
+gv_resolver_set_property(GObject      *object,
+                         guint         property_id,
+                         const GValue *value,
+                         GParamSpec   *pspec)
+{
+	GvResolver *self = GV_RESOLVER(object);
+
+	TRACE_SET_PROPERTY(object, property_id, value, pspec);
+
+	switch (property_id) {
+	case PROP_PLAYER:
+		gv_resolver_set_player(self, g_value_get_object(value));
+		break;
+	case PROP_STATION_LIST:
+		gv_resolver_set_station_list(self, g_value_get_object(value));
+		break;
+	case PROP_PAUSED:
+		gv_resolver_set_paused(self, g_value_get_boolean(value));
+		break;
+	default:
+		G_OBJECT_WARN_INVALID_PROPERTY_ID(object, property_id, pspec);
+		break;
+	}
+}
+
+/*
+ * Public methods
+ */
+
+GvResolver *
+gv_resolver_new(GvPlayer *player, GvStationList *station_list)
+{
+	return g_object_new(GV_TYPE_RESOLVER,
+	                    "player", player,
+	                    "station-list", station_list,
+	                    NULL);
+}
+
+/*
+ * GObject methods
+ */
+
+static void
+gv_resolver_finalize(GObject *object)
+{
+	GvResolverPrivate *priv = GV_RESOLVER(object)->priv;
+
+	TRACE("%p", object);
+
+	/* Stop resolving */
+	if (priv->source_id)
+		g_source_remove(priv->source_id);
+
+	g_queue_free_full(priv->queue, g_object_unref);
+
+	/* Unref construct-only properties */
+	g_object_unref(priv->station_list);
+	g_object_unref(priv->player);
+
+	/* Chain up */
+	G_OBJECT_CHAINUP_FINALIZE(gv_resolver, object);
+}
+
+static void
+gv_resolver_constructed(GObject *object)
+{
+	GvResolver *self = GV_RESOLVER(object);
+	GvResolverPrivate *priv = self->priv;
+
+	TRACE("%p", object);
+
+	/* Ensure construct-only properties have been set */
+	g_assert_nonnull(priv->player);
+	g_assert_nonnull(priv->station_list);
+
+	/* Initialize */
+	priv->queue = g_queue_new();
+
+	/* Chain up */
+	G_OBJECT_CHAINUP_CONSTRUCTED(gv_resolver, object);
+}
+
+static void
+gv_resolver_init(GvResolver *self)
+{
+	TRACE("%p", self);
+
+	/* Initialize private pointer */
+	self->priv = gv_resolver_get_instance_private(self);
+}
+
+static void
+gv_resolver_class_init(GvResolverClass *class)
+{
+	GObjectClass *object_class = G_OBJECT_CLASS(class);
+
+	TRACE("%p", class);
+
+	/* Override GObject methods */
+	object_class->finalize = gv_resolver_finalize;
+	object_class->constructed = gv_resolver_constructed;
+
+	/* Properties */
+	object_class->get_property = gv_resolver_get_property;
+	object_class->set_property = gv_resolver_set_property;
+
+	properties[PROP_PLAYER] =
+	        g_param_spec_object("player", "Player", NULL,
+	                            GV_TYPE_PLAYER,
+	                            GV_PARAM_DEFAULT_FLAGS | G_PARAM_WRITABLE |
+	                            G_PARAM_CONSTRUCT_ONLY);
+
+	properties[PROP_STATION_LIST] =
+	        g_param_spec_object("station-list", "Station list", NULL,
+	                            GV_TYPE_STATION_LIST,
+	                            GV_PARAM_DEFAULT_FLAGS | G_PARAM_WRITABLE |
+	                            G_PARAM_CONSTRUCT_ONLY);
+
+	properties[PROP_PAUSED] =
+	        g_param_spec_boolean("paused", "Paused", NULL,
+	                             FALSE,
+	                             GV_PARAM_DEFAULT_FLAGS | G_PARAM_READWRITE);
+
+	g_object_class_install_properties(object_class, PROP_N, properties);
+}
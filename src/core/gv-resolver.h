@@ -0,0 +1,45 @@
+/*
+ * Goodvibes Radio Player
+ *
+ * Copyright (C) 2015-2017 Arnaud Rebillout
+ *
+ * SPDX-License-Identifier: GPL-3.0-or-later
+ *
+ * This program is free software: you can redistribute it and/or modify
+ * it under the terms of the GNU General Public License as published by
+ * the Free Software Foundation, either version 3 of the License, or
+ * (at your option) any later version.
+ *
+ * This program is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ * GNU General Public License for more details.
+ *
+ * You should have received a copy of the GNU General Public License
+ * along with this program. If not, see <http://www.gnu.org/licenses/>.
+ */
+
+#ifndef __GOODVIBES_CORE_GV_RESOLVER_H__
+#define __GOODVIBES_CORE_GV_RESOLVER_H__
+
+#include <glib-object.h>
+
+#include "core/gv-player.h"
+#include "core/gv-station-list.h"
+
+/* GObject declarations */
+
+#define GV_TYPE_RESOLVER gv_resolver_get_type()
+
+G_DECLARE_FINAL_TYPE(GvResolver, gv_resolver, GV, RESOLVER, GObject)
+
+/* Methods */
+
+GvResolver *gv_resolver_new(GvPlayer *player, GvStationList *station_list);
+
+/* Property accessors */
+
+gboolean gv_resolver_get_paused(GvResolver *self);
+void     gv_resolver_set_paused(GvResolver *self, gboolean paused);
+
+#endif /* __GOODVIBES_CORE_GV_RESOLVER_H__ */
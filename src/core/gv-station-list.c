@@ -19,18 +19,21 @@
  * along with this program. If not, see <http://www.gnu.org/licenses/>.
  */
 
+#include <errno.h>
+#include <stdio.h>
 #include <string.h>
 #include <glib.h>
+#include <glib/gstdio.h>
 #include <glib-object.h>
+#include <gio/gio.h>
 
 #include "additions/glib-object.h"
 #include "framework/gv-framework.h"
 
+#include "core/gv-core-internal.h"
+#include "core/gv-playlist.h"
 #include "core/gv-station-list.h"
 
-// WISHED Try with a huge number of stations to see how it behaves.
-//        It might be slow. The implementation never tried to be fast.
-
 /*
  * FIP <http://www.fipradio.fr/>
  * Just the best radios you'll ever listen to.
@@ -155,38 +158,560 @@
 
 #define SAVE_DELAY 1
 
+/*
+ * Journal - edits are appended to the journal as they happen, and the journal
+ * is compacted (ie. the station list is saved) when it's too big or too old.
+ */
+
+#define JOURNAL_MAX_SIZE (64 * 1024)
+#define JOURNAL_MAX_AGE  300
+
+/*
+ * Markup chunk size - how much we read at once when parsing a file
+ */
+
+#define MARKUP_CHUNK_SIZE 4096
+
+/*
+ * Staged load - how many stations are loaded right away, then how many
+ * stations are loaded at each idle iteration.
+ */
+
+#define LOAD_FIRST_SLICE_SIZE 64
+#define LOAD_SLICE_SIZE       512
+
 /*
  * Signals
  */
 
 enum {
 	SIGNAL_LOADED,
+	SIGNAL_LOAD_PROGRESS,
 	SIGNAL_STATION_ADDED,
 	SIGNAL_STATION_REMOVED,
 	SIGNAL_STATION_MODIFIED,
 	SIGNAL_STATION_MOVED,
+	SIGNAL_CHANGED,
 	/* Number of signals */
 	SIGNAL_N
 };
 
 static guint signals[SIGNAL_N];
 
+/*
+ * Station records, a plain copy of the station properties that are saved.
+ * They can be handed over to another thread, unlike the stations themselves.
+ */
+
+typedef struct {
+	gchar  *uri;
+	gchar  *name;
+	gchar  *user_agent;
+	/* Learnt along the way, only saved in the cache */
+	gchar **stream_uris;
+	guint   nominal_bitrate;
+} GvStationRecord;
+
+static void
+gv_station_record_free(GvStationRecord *record)
+{
+	g_strfreev(record->stream_uris);
+	g_free(record->uri);
+	g_free(record->name);
+	g_free(record->user_agent);
+	g_free(record);
+}
+
+static GvStationRecord *
+gv_station_record_new(GvStation *station)
+{
+	GvStationRecord *record;
+	GSList *item;
+	guint i;
+
+	record = g_new0(GvStationRecord, 1);
+	record->uri = g_strdup(gv_station_get_uri(station));
+	record->name = g_strdup(gv_station_get_name(station));
+	record->user_agent = g_strdup(gv_station_get_user_agent(station));
+	record->nominal_bitrate = gv_station_get_nominal_bitrate(station);
+
+	item = gv_station_get_stream_uris(station);
+	record->stream_uris = g_new0(gchar *, g_slist_length(item) + 1);
+	for (i = 0; item; item = item->next, i++)
+		record->stream_uris[i] = g_strdup(item->data);
+
+	return record;
+}
+
+/*
+ * Save jobs, processed by the save thread
+ */
+
+typedef struct {
+	gchar     *path;
+	GPtrArray *records;
+	/* Only refresh the cache, the records match the saved file */
+	gboolean   cache_only;
+} GvSaveJob;
+
+static void
+gv_save_job_free(GvSaveJob *job)
+{
+	g_ptr_array_free(job->records, TRUE);
+	g_free(job->path);
+	g_free(job);
+}
+
+static void
+gv_save_job_add_station(GvSaveJob *job, GvStation *station)
+{
+	g_ptr_array_add(job->records, gv_station_record_new(station));
+}
+
+static GvSaveJob *
+gv_save_job_new(const gchar *path, gboolean cache_only, guint n_stations)
+{
+	GvSaveJob *job;
+
+	job = g_new0(GvSaveJob, 1);
+	job->path = g_strdup(path);
+	job->cache_only = cache_only;
+	job->records = g_ptr_array_new_full(n_stations,
+	                                    (GDestroyNotify) gv_station_record_free);
+
+	return job;
+}
+
+/*
+ * Binary cache
+ *
+ * The cache is a copy of the user station list file, that can be mapped
+ * in memory and used as is. It starts with a header, followed by a table
+ * of stations, a table of stream uris, and finally a table of strings.
+ * Strings are referred to by their offset in the string table, 0 being
+ * NULL. The cache is bound to a given version of the station list file,
+ * it's discarded as soon as the file is modified.
+ */
+
+#define CACHE_MAGIC   "GVSTLIST"
+#define CACHE_VERSION 1
+
+typedef struct {
+	gchar   magic[8];
+	guint32 version;
+	guint32 n_stations;
+	guint32 n_stream_uris;
+	guint32 strings_size;
+	gint64  file_mtime;
+	guint64 file_size;
+	/* Checksum of the file, to check the journal against */
+	guint32 base;
+	guint32 padding;
+} GvCacheHeader;
+
+typedef struct {
+	guint32 uri;
+	guint32 name;
+	guint32 user_agent;
+	guint32 nominal_bitrate;
+	/* Index in the stream uri table */
+	guint32 first_stream_uri;
+	guint32 n_stream_uris;
+} GvCacheStation;
+
+static guint32
+cache_add_string(GByteArray *strings, GHashTable *offsets, const gchar *str)
+{
+	gpointer offset;
+
+	if (str == NULL)
+		return 0;
+
+	if (g_hash_table_lookup_extended(offsets, str, NULL, &offset))
+		return GPOINTER_TO_UINT(offset);
+
+	offset = GUINT_TO_POINTER(strings->len);
+	g_byte_array_append(strings, (const guint8 *) str, strlen(str) + 1);
+	g_hash_table_insert(offsets, (gpointer) str, offset);
+
+	return GPOINTER_TO_UINT(offset);
+}
+
+static gboolean
+cache_write(const gchar *path, GPtrArray *records, const gchar *base,
+            const GStatBuf *file_stat, GError **err)
+{
+	GvCacheHeader header;
+	GArray *stations, *stream_uris;
+	GByteArray *strings, *data;
+	GHashTable *offsets;
+	gboolean ret;
+	guint i;
+
+	stations = g_array_sized_new(FALSE, FALSE, sizeof(GvCacheStation), records->len);
+	stream_uris = g_array_new(FALSE, FALSE, sizeof(guint32));
+	strings = g_byte_array_new();
+	offsets = g_hash_table_new(g_str_hash, g_str_equal);
+
+	/* Offset 0 is reserved for NULL */
+	g_byte_array_append(strings, (const guint8 *) "", 1);
+
+	for (i = 0; i < records->len; i++) {
+		GvStationRecord *record = g_ptr_array_index(records, i);
+		GvCacheStation station;
+		gchar **uri;
+
+		station.uri = cache_add_string(strings, offsets, record->uri);
+		station.name = cache_add_string(strings, offsets, record->name);
+		station.user_agent = cache_add_string(strings, offsets, record->user_agent);
+		station.nominal_bitrate = record->nominal_bitrate;
+		station.first_stream_uri = stream_uris->len;
+		station.n_stream_uris = 0;
+
+		for (uri = record->stream_uris; uri && *uri; uri++) {
+			guint32 offset = cache_add_string(strings, offsets, *uri);
+
+			g_array_append_val(stream_uris, offset);
+			station.n_stream_uris++;
+		}
+
+		g_array_append_val(stations, station);
+	}
+
+	memset(&header, 0, sizeof header);
+	memcpy(header.magic, CACHE_MAGIC, sizeof header.magic);
+	header.version = CACHE_VERSION;
+	header.n_stations = stations->len;
+	header.n_stream_uris = stream_uris->len;
+	header.base = cache_add_string(strings, offsets, base);
+	header.strings_size = strings->len;
+	header.file_mtime = file_stat->st_mtime;
+	header.file_size = file_stat->st_size;
+
+	/* Put everything together, and write it atomically */
+	data = g_byte_array_sized_new(sizeof header +
+	                              stations->len * sizeof(GvCacheStation) +
+	                              stream_uris->len * sizeof(guint32) +
+	                              strings->len);
+	g_byte_array_append(data, (const guint8 *) &header, sizeof header);
+	g_byte_array_append(data, (const guint8 *) stations->data,
+	                    stations->len * sizeof(GvCacheStation));
+	g_byte_array_append(data, (const guint8 *) stream_uris->data,
+	                    stream_uris->len * sizeof(guint32));
+	g_byte_array_append(data, strings->data, strings->len);
+
+	ret = g_file_set_contents(path, (const gchar *) data->data, data->len, err);
+
+	g_byte_array_free(data, TRUE);
+	g_hash_table_destroy(offsets);
+	g_byte_array_free(strings, TRUE);
+	g_array_free(stream_uris, TRUE);
+	g_array_free(stations, TRUE);
+
+	return ret;
+}
+
+typedef struct {
+	GMappedFile          *file;
+	const GvCacheHeader  *header;
+	const GvCacheStation *stations;
+	const guint32        *stream_uris;
+	const gchar          *strings;
+} GvCache;
+
+static void
+cache_close(GvCache *cache)
+{
+	g_mapped_file_unref(cache->file);
+	g_free(cache);
+}
+
+/* Open the cache, provided it's valid and up to date with the station list
+ * file. Returns NULL otherwise. Everything is checked at once, so that the
+ * stations can be read later on without any check.
+ */
+static GvCache *
+cache_open(const gchar *path, const gchar *file_path)
+{
+	GvCache *cache;
+	GMappedFile *file;
+	GError *err = NULL;
+	GStatBuf file_stat;
+	const GvCacheHeader *header;
+	const GvCacheStation *stations;
+	const guint32 *stream_uris;
+	const gchar *strings;
+	const gchar *data;
+	guint64 expected_size;
+	gsize size;
+	guint i;
+
+	/* The cache is useless without the file it was made from */
+	if (g_stat(file_path, &file_stat) != 0)
+		return NULL;
+
+	file = g_mapped_file_new(path, FALSE, &err);
+	if (file == NULL) {
+		DEBUG("No station list cache: %s", err->message);
+		g_error_free(err);
+		return NULL;
+	}
+
+	data = g_mapped_file_get_contents(file);
+	size = g_mapped_file_get_length(file);
+
+	/* Check the header */
+	header = (const GvCacheHeader *) data;
+	if (size < sizeof *header ||
+	    memcmp(header->magic, CACHE_MAGIC, sizeof header->magic) ||
+	    header->version != CACHE_VERSION) {
+		INFO("Invalid station list cache, discarded");
+		goto error;
+	}
+
+	if (header->file_mtime != (gint64) file_stat.st_mtime ||
+	    header->file_size != (guint64) file_stat.st_size) {
+		INFO("Station list cache is out of date, discarded");
+		goto error;
+	}
+
+	/* Check the tables, so that no offset goes beyond the end of the file */
+	expected_size = sizeof *header +
+	                (guint64) header->n_stations * sizeof(GvCacheStation) +
+	                (guint64) header->n_stream_uris * sizeof(guint32) +
+	                header->strings_size;
+	if (expected_size != size || header->strings_size == 0) {
+		INFO("Invalid station list cache size, discarded");
+		goto error;
+	}
+
+	stations = (const GvCacheStation *) (data + sizeof *header);
+	stream_uris = (const guint32 *) (stations + header->n_stations);
+	strings = (const gchar *) (stream_uris + header->n_stream_uris);
+
+	/* The string table must be terminated, and have a base */
+	if (strings[header->strings_size - 1] != '\0' ||
+	    header->base == 0 || header->base >= header->strings_size) {
+		INFO("Invalid station list cache strings, discarded");
+		goto error;
+	}
+
+	for (i = 0; i < header->n_stream_uris; i++) {
+		if (stream_uris[i] == 0 || stream_uris[i] >= header->strings_size) {
+			INFO("Invalid station list cache stream uris, discarded");
+			goto error;
+		}
+	}
+
+	for (i = 0; i < header->n_stations; i++) {
+		const GvCacheStation *entry = &stations[i];
+
+		if (entry->uri == 0 || entry->uri >= header->strings_size ||
+		    entry->name >= header->strings_size ||
+		    entry->user_agent >= header->strings_size ||
+		    entry->first_stream_uri > header->n_stream_uris ||
+		    entry->n_stream_uris > header->n_stream_uris - entry->first_stream_uri) {
+			INFO("Invalid station list cache entry, discarded");
+			goto error;
+		}
+	}
+
+	cache = g_new0(GvCache, 1);
+	cache->file = file;
+	cache->header = header;
+	cache->stations = stations;
+	cache->stream_uris = stream_uris;
+	cache->strings = strings;
+
+	return cache;
+
+error:
+	g_mapped_file_unref(file);
+
+	return NULL;
+}
+
+static const gchar *
+cache_get_base(GvCache *cache)
+{
+	return cache->strings + cache->header->base;
+}
+
+static guint
+cache_get_length(GvCache *cache)
+{
+	return cache->header->n_stations;
+}
+
+static const gchar *
+cache_get_uri(GvCache *cache, guint i)
+{
+	return cache->strings + cache->stations[i].uri;
+}
+
+static GvStation *
+cache_get_station(GvCache *cache, guint i)
+{
+	const GvCacheStation *entry = &cache->stations[i];
+	const gchar *strings = cache->strings;
+	GvStation *station;
+	GSList *list = NULL;
+	guint j;
+
+	station = gv_station_new(entry->name ? strings + entry->name : NULL,
+	                         strings + entry->uri);
+	if (entry->user_agent)
+		gv_station_set_user_agent(station, strings + entry->user_agent);
+	gv_station_set_nominal_bitrate(station, entry->nominal_bitrate);
+
+	for (j = entry->n_stream_uris; j > 0; j--) {
+		guint32 offset = cache->stream_uris[entry->first_stream_uri + j - 1];
+
+		list = g_slist_prepend(list, (gpointer) (strings + offset));
+	}
+	if (list) {
+		gv_station_set_stream_uris(station, list);
+		g_slist_free(list);
+	}
+
+	return g_object_ref_sink(station);
+}
+
+/*
+ * Station loader, the source of the stations during a staged load
+ */
+
+typedef struct {
+	/* Stations come either from the cache, or from an array */
+	GvCache       *cache;
+	GPtrArray     *stations;
+	guint          length;
+	/* Next station to load */
+	guint          next;
+	/* Station loaded ahead of the others, and its position */
+	guint          current;
+	GSequenceIter *current_iter;
+} GvLoader;
+
+static void
+gv_loader_free(GvLoader *loader)
+{
+	if (loader->cache)
+		cache_close(loader->cache);
+	if (loader->stations)
+		g_ptr_array_free(loader->stations, TRUE);
+	g_free(loader);
+}
+
+/* Takes ownership of either the cache or the array */
+static GvLoader *
+gv_loader_new(GvCache *cache, GPtrArray *stations)
+{
+	GvLoader *loader;
+
+	loader = g_new0(GvLoader, 1);
+	loader->cache = cache;
+	loader->stations = stations;
+	loader->length = cache ? cache_get_length(cache) : stations->len;
+	loader->current = G_MAXUINT;
+
+	return loader;
+}
+
+static const gchar *
+gv_loader_get_uri(GvLoader *loader, guint i)
+{
+	if (loader->cache)
+		return cache_get_uri(loader->cache, i);
+	else
+		return gv_station_get_uri(g_ptr_array_index(loader->stations, i));
+}
+
+static guint
+gv_loader_find_by_uri(GvLoader *loader, const gchar *uri)
+{
+	guint i;
+
+	for (i = 0; i < loader->length; i++) {
+		if (!g_strcmp0(gv_loader_get_uri(loader, i), uri))
+			return i;
+	}
+
+	return G_MAXUINT;
+}
+
+/* Returns a new reference */
+static GvStation *
+gv_loader_get_station(GvLoader *loader, guint i)
+{
+	if (loader->cache)
+		return cache_get_station(loader->cache, i);
+	else
+		return g_object_ref(g_ptr_array_index(loader->stations, i));
+}
+
 /*
  * GObject definitions
  */
 
+typedef struct _GvSnapshot GvSnapshot;
+
 struct _GvStationListPrivate {
 	/* Load/save pathes */
-	GSList *load_pathes;
-	gchar  *save_path;
+	GSList     *load_pathes;
+	gchar      *save_path;
+	gchar      *cache_path;
+	/* Whether learnt data changed since the cache was written */
+	gboolean    cache_dirty;
 	/* Timeout id, > 0 if a save operation is scheduled */
-	guint   save_source_id;
-	/* Ordered list of stations */
-	GList  *stations;
-	/* Shuffled list of stations, automatically created
-	 * and destroyed when needed.
-	 */
-	GList  *shuffled;
+	guint       save_source_id;
+	/* Save thread, and data shared with it (protected by the mutex) */
+	GThread    *save_thread;
+	GMutex      save_mutex;
+	GCond       save_cond;
+	GvSaveJob  *save_job;
+	GString    *journal_lines;
+	gboolean    save_quit;
+	guint       save_done_source_id;
+	GError     *save_error;
+	/* Journal, the base and the file belong to the save thread */
+	gchar      *journal_path;
+	gboolean    journal_enabled;
+	gsize       journal_size;
+	gchar      *journal_base;
+	FILE       *journal_file;
+	/* Staged load, NULL once all stations are loaded */
+	GvLoader   *loader;
+	guint       load_source_id;
+	/* Ordered sequence of stations */
+	GSequence  *stations;
+	/* Incremented each time the sequence is modified */
+	guint       generation;
+	/* Latest snapshot, and every snapshot alive */
+	GvSnapshot *snapshot;
+	GList      *snapshots;
+	/* Position of each station in the sequence */
+	GHashTable *iters;
+	/* Shuffle order, automatically created and destroyed when needed */
+	GPtrArray  *shuffled;
+	GHashTable *shuffled_pos;
+	guint       shuffled_drawn;
+	guint       shuffled_holes;
+	GvStation  *shuffled_wrap;
+	/* Lookup indexes, kept in sync with the station list */
+	GHashTable *name_index;
+	GHashTable *uri_index;
+	GHashTable *uid_index;
+	/* Keys under which each station is currently indexed */
+	GHashTable *indexed_keys;
+	/* Batch nesting level, > 0 while a batch is ongoing */
+	guint       batch_depth;
+	/* Changes recorded during a batch */
+	GHashTable *batch_added;
+	GHashTable *batch_removed;
+	GHashTable *batch_moved;
+	GHashTable *batch_modified;
+	gboolean    batch_needs_save;
 };
 
 typedef struct _GvStationListPrivate GvStationListPrivate;
@@ -206,9 +731,12 @@ G_DEFINE_TYPE_WITH_CODE(GvStationList, gv_station_list, G_TYPE_OBJECT,
  * Markup handling
  */
 
+typedef void (*GvMarkupStationFunc) (GvStation *station, gpointer user_data);
+
 struct _GvMarkupParsing {
 	/* Persistent during the whole parsing process */
-	GList  *list;
+	GvMarkupStationFunc func;
+	gpointer            user_data;
 	/* Current iteration */
 	gchar **cur;
 	gchar  *name;
@@ -221,24 +749,27 @@ typedef struct _GvMarkupParsing GvMarkupParsing;
 static void
 markup_on_text(GMarkupParseContext  *context G_GNUC_UNUSED,
                const gchar          *text,
-               gsize                 text_len G_GNUC_UNUSED,
+               gsize                 text_len,
                gpointer              user_data,
                GError              **error G_GNUC_UNUSED)
 {
 	GvMarkupParsing *parsing = user_data;
+	gchar *prev;
 
 	/* Happens all the time */
 	if (parsing->cur == NULL)
 		return;
 
-	/* Should never happen */
-	g_assert_null(*parsing->cur);
-
-	/* Save text */
-	*parsing->cur = g_strdup(text);
-
-	/* Cleanup */
-	parsing->cur = NULL;
+	/* Save text. Since the input is fed in chunks, we might get the
+	 * text of a node in several pieces.
+	 */
+	prev = *parsing->cur;
+	if (prev == NULL) {
+		*parsing->cur = g_strndup(text, text_len);
+	} else {
+		*parsing->cur = g_strconcat(prev, text, NULL);
+		g_free(prev);
+	}
 }
 
 static void
@@ -250,6 +781,9 @@ markup_on_end_element(GMarkupParseContext  *context G_GNUC_UNUSED,
 	GvMarkupParsing *parsing = user_data;
 	GvStation *station;
 
+	/* Leaving a property node */
+	parsing->cur = NULL;
+
 	/* We only care when we leave a station node */
 	if (g_strcmp0(element_name, "Station"))
 		return;
@@ -265,11 +799,9 @@ markup_on_end_element(GMarkupParseContext  *context G_GNUC_UNUSED,
 	if (parsing->user_agent)
 		gv_station_set_user_agent(station, parsing->user_agent);
 
-	/* We must take ownership right now */
+	/* We must take ownership right now, then hand it over */
 	g_object_ref_sink(station);
-
-	/* Add to list, use prepend for efficiency */
-	parsing->list = g_list_prepend(parsing->list, station);
+	parsing->func(station, parsing->user_data);
 
 cleanup:
 	/* Cleanup */
@@ -343,8 +875,14 @@ markup_on_error(GMarkupParseContext *context G_GNUC_UNUSED,
 	parsing->user_agent = NULL;
 }
 
-static GList *
-parse_markup(const gchar *text, GError **err)
+/* Parse a station list from a stream, chunk by chunk. Each station is handed
+ * over to 'func' as soon as it's parsed, and the caller is responsible for
+ * discarding these stations if parsing fails in the end. If 'checksum' is
+ * given, it's updated with the whole input.
+ */
+static gboolean
+parse_markup(GInputStream *stream, GChecksum *checksum,
+             GvMarkupStationFunc func, gpointer user_data, GError **err)
 {
 	GMarkupParseContext *context;
 	GMarkupParser parser = {
@@ -355,18 +893,38 @@ parse_markup(const gchar *text, GError **err)
 		markup_on_error,
 	};
 	GvMarkupParsing parsing = {
-		NULL,
+		func,
+		user_data,
 		NULL,
 		NULL,
 		NULL,
 		NULL
 	};
+	gchar buf[MARKUP_CHUNK_SIZE];
+	gssize n_read;
+	gboolean ret = FALSE;
 
 	context = g_markup_parse_context_new(&parser, 0, &parsing, NULL);
-	g_markup_parse_context_parse(context, text, -1, err);
+
+	while ((n_read = g_input_stream_read(stream, buf, sizeof buf, NULL, err)) > 0) {
+		if (checksum)
+			g_checksum_update(checksum, (const guchar *) buf, n_read);
+
+		if (!g_markup_parse_context_parse(context, buf, n_read, err))
+			goto cleanup;
+	}
+
+	if (n_read < 0)
+		goto cleanup;
+
+	ret = g_markup_parse_context_end_parse(context, err);
+
+cleanup:
+	/* Discard the station being parsed, if any */
+	markup_on_error(context, NULL, &parsing);
 	g_markup_parse_context_free(context);
 
-	return g_list_reverse(parsing.list);
+	return ret;
 }
 
 static GString *
@@ -382,11 +940,11 @@ g_string_append_markup_tag_escaped(GString *string, const gchar *tag, const gcha
 }
 
 static gchar *
-print_markup_station(GvStation *station)
+print_markup_station(GvStationRecord *record)
 {
-	const gchar *name = gv_station_get_name(station);
-	const gchar *uri = gv_station_get_uri(station);
-	const gchar *user_agent = gv_station_get_user_agent(station);
+	const gchar *name = record->name;
+	const gchar *uri = record->uri;
+	const gchar *user_agent = record->user_agent;
 	GString *string;
 
 	/* A station is supposed to have an uri */
@@ -414,18 +972,18 @@ print_markup_station(GvStation *station)
 }
 
 static gchar *
-print_markup(GList *list, GError **err G_GNUC_UNUSED)
+print_markup(GPtrArray *records, GError **err G_GNUC_UNUSED)
 {
-	GList *item;
 	GString *string = g_string_new(NULL);
+	guint i;
 
 	g_string_append(string, "<Stations>\n");
 
-	for (item = list; item; item = item->next) {
-		GvStation *station = GV_STATION(item->data);
+	for (i = 0; i < records->len; i++) {
+		GvStationRecord *record = g_ptr_array_index(records, i);
 		gchar *text;
 
-		text = print_markup_station(station);
+		text = print_markup_station(record);
 		if (text == NULL)
 			continue;
 
@@ -439,241 +997,1376 @@ print_markup(GList *list, GError **err G_GNUC_UNUSED)
 }
 
 /*
- * Iterator implementation
+ * Journal handling
+ *
+ * The journal is a text file. The first line identifies the snapshot it
+ * applies to, then each line describes an edit, with tab-separated fields.
+ * Strings are escaped and prefixed with '=', while an empty field is NULL.
  */
 
-struct _GvStationListIter {
-	GList *head, *item;
-};
-
-GvStationListIter *
-gv_station_list_iter_new(GvStationList *self)
+static gchar *
+journal_escape(const gchar *value)
 {
-	GList *list = self->priv->stations;
-	GvStationListIter *iter;
+	gchar *escaped;
+	gchar *field;
 
-	iter = g_new0(GvStationListIter, 1);
-	iter->head = g_list_copy_deep(list, (GCopyFunc) g_object_ref, NULL);
-	iter->item = iter->head;
+	if (value == NULL)
+		return g_strdup("");
 
-	return iter;
+	escaped = g_strescape(value, NULL);
+	field = g_strconcat("=", escaped, NULL);
+	g_free(escaped);
+
+	return field;
 }
 
-void
-gv_station_list_iter_free(GvStationListIter *iter)
+static gchar *
+journal_unescape(const gchar *field)
 {
-	g_return_if_fail(iter != NULL);
+	if (field[0] != '=')
+		return NULL;
 
-	g_list_free_full(iter->head, g_object_unref);
-	g_free(iter);
+	return g_strcompress(field + 1);
 }
 
-gboolean
-gv_station_list_iter_loop(GvStationListIter *iter, GvStation **station)
+static gboolean
+journal_parse_position(const gchar *field, guint max, guint *pos)
 {
-	g_return_val_if_fail(iter != NULL, FALSE);
-	g_return_val_if_fail(station != NULL, FALSE);
-
-	*station = NULL;
+	guint64 value;
+	gchar *endptr;
 
-	if (iter->item == NULL)
+	value = g_ascii_strtoull(field, &endptr, 10);
+	if (endptr == field || *endptr != '\0' || value > max)
 		return FALSE;
 
-	*station = iter->item->data;
-	iter->item = iter->item->next;
-
+	*pos = value;
 	return TRUE;
 }
 
-/*
- * GList additions
- */
-
-static gint
-glist_sortfunc_random(gconstpointer a G_GNUC_UNUSED, gconstpointer b G_GNUC_UNUSED)
+static gchar *
+journal_print_header(const gchar *base)
 {
-	return g_random_boolean() ? 1 : -1;
+	return g_strdup_printf("journal\t%s\n", base);
 }
 
-static GList *
-g_list_shuffle(GList *list)
+static gchar *
+journal_print_station(const gchar *op, guint pos, GvStation *station)
 {
-	/* Shuffle twice. Credits goes to:
-	 * http://www.linuxforums.org/forum/programming-scripting/
-	 * 202125-fastest-way-shuffle-linked-list.html
-	 */
-	list = g_list_sort(list, glist_sortfunc_random);
-	list = g_list_sort(list, glist_sortfunc_random);
-	return list;
+	gchar *uri = journal_escape(gv_station_get_uri(station));
+	gchar *name = journal_escape(gv_station_get_name(station));
+	gchar *user_agent = journal_escape(gv_station_get_user_agent(station));
+	gchar *line;
+
+	line = g_strdup_printf("%s\t%u\t%s\t%s\t%s\n", op, pos, uri, name, user_agent);
+
+	g_free(user_agent);
+	g_free(name);
+	g_free(uri);
+
+	return line;
 }
 
-static GList *
-g_list_copy_deep_shuffle(GList *list, GCopyFunc func, gpointer user_data)
+static gchar *
+journal_print_remove(guint pos)
 {
-	list = g_list_copy_deep(list, func, user_data);
-	list = g_list_shuffle(list);
-	return list;
+	return g_strdup_printf("remove\t%u\n", pos);
 }
 
-/*
- * Helpers
- */
+static gchar *
+journal_print_move(guint from, guint to)
+{
+	return g_strdup_printf("move\t%u\t%u\n", from, to);
+}
 
-static gint
-are_stations_similar(GvStation *s1, GvStation *s2)
+static gboolean
+journal_replay_line(GPtrArray *stations, const gchar *line)
 {
-	if (s1 == s2) {
-		WARNING("Stations %p and %p are the same", s1, s2);
-		return 0;
-	}
+	gchar **fields;
+	guint n_fields;
+	guint pos, to;
+	gboolean ret = FALSE;
+
+	fields = g_strsplit(line, "\t", -1);
+	n_fields = g_strv_length(fields);
+	if (n_fields < 2)
+		goto cleanup;
 
-	if (s1 == NULL || s2 == NULL)
-		return -1;
+	if (!g_strcmp0(fields[0], "add") && n_fields == 5) {
+		gchar *uri, *name, *user_agent;
+		GvStation *station;
 
-	/* Compare uids */
-	const gchar *s1_uid, *s2_uid;
-	s1_uid = gv_station_get_uid(s1);
-	s2_uid = gv_station_get_uid(s2);
+		if (!journal_parse_position(fields[1], stations->len, &pos))
+			goto cleanup;
 
-	if (!g_strcmp0(s1_uid, s2_uid)) {
-		WARNING("Stations %p and %p have the same uid '%s'", s1, s2, s1_uid);
-		return 0;
-	}
+		uri = journal_unescape(fields[2]);
+		name = journal_unescape(fields[3]);
+		user_agent = journal_unescape(fields[4]);
 
-	/* Compare names.
-	 * Two stations who don't have name are different.
-	 */
-	const gchar *s1_name, *s2_name;
-	s1_name = gv_station_get_name(s1);
-	s2_name = gv_station_get_name(s2);
+		if (uri) {
+			station = gv_station_new(name, uri);
+			if (user_agent)
+				gv_station_set_user_agent(station, user_agent);
+			g_ptr_array_insert(stations, pos, g_object_ref_sink(station));
+			ret = TRUE;
+		}
 
-	if (s1_name == NULL && s2_name == NULL)
-		return -1;
+		g_free(user_agent);
+		g_free(name);
+		g_free(uri);
 
-	if (!g_strcmp0(s1_name, s2_name)) {
-		DEBUG("Stations %p and %p have the same name '%s'", s1, s2, s1_name);
-		return 0;
-	}
+	} else if (!g_strcmp0(fields[0], "modify") && n_fields == 5) {
+		gchar *uri, *name, *user_agent;
+		GvStation *station;
 
-	/* Compare uris */
-	const gchar *s1_uri, *s2_uri;
-	s1_uri = gv_station_get_uri(s1);
-	s2_uri = gv_station_get_uri(s2);
+		if (stations->len == 0 ||
+		    !journal_parse_position(fields[1], stations->len - 1, &pos))
+			goto cleanup;
 
-	if (!g_strcmp0(s1_uri, s2_uri)) {
-		DEBUG("Stations %p and %p have the same uri '%s'", s1, s2, s1_uri);
-		return 0;
-	}
+		uri = journal_unescape(fields[2]);
+		name = journal_unescape(fields[3]);
+		user_agent = journal_unescape(fields[4]);
 
-	return -1;
-}
+		if (uri) {
+			station = g_ptr_array_index(stations, pos);
+			gv_station_set_uri(station, uri);
+			gv_station_set_name(station, name);
+			gv_station_set_user_agent(station, user_agent);
+			ret = TRUE;
+		}
 
-/*
- * Signal handlers
- */
+		g_free(user_agent);
+		g_free(name);
+		g_free(uri);
 
-static gboolean
-when_timeout_save_station_list(gpointer data)
-{
-	GvStationList *self = GV_STATION_LIST(data);
-	GvStationListPrivate *priv = self->priv;
+	} else if (!g_strcmp0(fields[0], "remove") && n_fields == 2) {
+		if (stations->len == 0 ||
+		    !journal_parse_position(fields[1], stations->len - 1, &pos))
+			goto cleanup;
 
-	gv_station_list_save(self);
+		g_ptr_array_remove_index(stations, pos);
+		ret = TRUE;
 
-	priv->save_source_id = 0;
+	} else if (!g_strcmp0(fields[0], "move") && n_fields == 3) {
+		GvStation *station;
 
-	return G_SOURCE_REMOVE;
-}
+		if (stations->len == 0 ||
+		    !journal_parse_position(fields[1], stations->len - 1, &pos) ||
+		    !journal_parse_position(fields[2], stations->len - 1, &to))
+			goto cleanup;
 
-static void
-gv_station_list_save_delayed(GvStationList *self)
-{
-	GvStationListPrivate *priv = self->priv;
+		station = g_object_ref(g_ptr_array_index(stations, pos));
+		g_ptr_array_remove_index(stations, pos);
+		g_ptr_array_insert(stations, to, station);
+		ret = TRUE;
+	}
 
-	if (priv->save_source_id > 0)
-		g_source_remove(priv->save_source_id);
+cleanup:
+	g_strfreev(fields);
 
-	priv->save_source_id =
-	        g_timeout_add_seconds(SAVE_DELAY, when_timeout_save_station_list, self);
+	return ret;
 }
 
-static void
-on_station_notify(GvStation     *station,
-                  GParamSpec     *pspec,
+/* Replay the journal on the stations loaded from the snapshot. The journal
+ * is discarded if it doesn't belong to this snapshot, and only partially
+ * replayed if it's corrupted. In both cases, FALSE is returned, since the
+ * journal can't be appended to.
+ */
+static gboolean
+journal_replay(const gchar *text, const gchar *base, GPtrArray *stations)
+{
+	gchar **lines;
+	gchar *header;
+	guint n_lines;
+	guint i;
+	gboolean ret = TRUE;
+
+	lines = g_strsplit(text, "\n", -1);
+	n_lines = g_strv_length(lines);
+
+	/* Check that the journal belongs to the snapshot */
+	header = journal_print_header(base);
+	header[strlen(header) - 1] = '\0';
+	if (n_lines == 0 || g_strcmp0(lines[0], header)) {
+		INFO("Journal doesn't match the station list, discarded");
+		ret = FALSE;
+		goto cleanup;
+	}
+
+	/* Replay each edit. The last line is expected to be empty,
+	 * otherwise it was not fully written.
+	 */
+	for (i = 1; i < n_lines - 1; i++) {
+		if (journal_replay_line(stations, lines[i]))
+			continue;
+
+		WARNING("Invalid journal line %u: '%s'", i + 1, lines[i]);
+		ret = FALSE;
+		goto cleanup;
+	}
+
+	if (lines[n_lines - 1][0] != '\0') {
+		WARNING("Journal is truncated");
+		ret = FALSE;
+		goto cleanup;
+	}
+
+	DEBUG("Replayed %u edits from journal", n_lines - 2);
+
+cleanup:
+	g_free(header);
+	g_strfreev(lines);
+
+	return ret;
+}
+
+/*
+ * Iterator implementation
+ *
+ * Iterators walk through a snapshot of the station list. Snapshots are shared
+ * between iterators, and made again only when the station list has changed,
+ * as tracked by a generation counter. Snapshots don't hold references on the
+ * stations: instead, when a station is removed from the list, each snapshot
+ * alive takes a reference on it.
+ */
+
+struct _GvSnapshot {
+	GvStationList *owner;
+	guint          ref_count;
+	guint          generation;
+	GvStation    **stations;
+	guint          length;
+	/* Stations removed from the list while the snapshot is alive */
+	GPtrArray     *removed;
+};
+
+struct _GvStationListIter {
+	GvSnapshot *snapshot;
+	guint       pos;
+};
+
+static GvSnapshot *gv_snapshot_new  (GvStationList *owner);
+static void        gv_snapshot_unref(GvSnapshot *snapshot);
+
+GvStationListIter *
+gv_station_list_iter_new(GvStationList *self)
+{
+	GvStationListPrivate *priv = self->priv;
+	GvStationListIter *iter;
+
+	/* Make a new snapshot only if the list changed since the last one */
+	if (priv->snapshot && priv->snapshot->generation != priv->generation)
+		g_clear_pointer(&priv->snapshot, gv_snapshot_unref);
+
+	if (priv->snapshot == NULL)
+		priv->snapshot = gv_snapshot_new(self);
+
+	iter = g_new0(GvStationListIter, 1);
+	iter->snapshot = priv->snapshot;
+	iter->snapshot->ref_count++;
+
+	return iter;
+}
+
+void
+gv_station_list_iter_free(GvStationListIter *iter)
+{
+	g_return_if_fail(iter != NULL);
+
+	gv_snapshot_unref(iter->snapshot);
+	g_free(iter);
+}
+
+gboolean
+gv_station_list_iter_loop(GvStationListIter *iter, GvStation **station)
+{
+	g_return_val_if_fail(iter != NULL, FALSE);
+	g_return_val_if_fail(station != NULL, FALSE);
+
+	*station = NULL;
+
+	if (iter->pos >= iter->snapshot->length)
+		return FALSE;
+
+	*station = iter->snapshot->stations[iter->pos];
+	iter->pos++;
+
+	return TRUE;
+}
+
+/*
+ * Shuffle order
+ *
+ * The shuffle order is an array of stations, drawn lazily with the
+ * Fisher-Yates algorithm. Stations in [0, drawn) were drawn already, and are
+ * in shuffled order. Stations in [drawn, len) are yet to be drawn, in no
+ * particular order. Drawing the next station is O(1), so is adding or removing
+ * a station: new stations go to the undrawn part, and removed stations leave
+ * a hole (NULL) in the drawn part, to keep the order of what was played.
+ * Holes are compacted when there are too many of them, or on wrap-around.
+ * The station we wrapped around from is remembered, so that asking again for
+ * its next station, or for the previous station of the new first one, gives
+ * the same answers.
+ */
+
+static void
+shuffle_set(GvStationListPrivate *priv, guint i, GvStation *station)
+{
+	g_ptr_array_index(priv->shuffled, i) = station;
+	if (station)
+		g_hash_table_insert(priv->shuffled_pos, station, GUINT_TO_POINTER(i));
+}
+
+static void
+shuffle_swap(GvStationListPrivate *priv, guint i, guint j)
+{
+	GvStation *station_i = g_ptr_array_index(priv->shuffled, i);
+	GvStation *station_j = g_ptr_array_index(priv->shuffled, j);
+
+	if (i == j)
+		return;
+
+	shuffle_set(priv, i, station_j);
+	shuffle_set(priv, j, station_i);
+}
+
+static guint
+shuffle_position(GvStationListPrivate *priv, GvStation *station, gboolean *found)
+{
+	gpointer value = NULL;
+
+	*found = g_hash_table_lookup_extended(priv->shuffled_pos, station, NULL, &value);
+
+	return GPOINTER_TO_UINT(value);
+}
+
+/* Draw a station at random among the undrawn ones, and put it next in line */
+static void
+shuffle_draw(GvStationListPrivate *priv)
+{
+	guint len = priv->shuffled->len;
+	guint drawn = priv->shuffled_drawn;
+
+	g_assert(drawn < len);
+
+	shuffle_swap(priv, drawn, g_random_int_range(drawn, len));
+	priv->shuffled_drawn++;
+}
+
+static void
+shuffle_draw_all(GvStationListPrivate *priv)
+{
+	while (priv->shuffled_drawn < priv->shuffled->len)
+		shuffle_draw(priv);
+}
+
+/* Ensure a station is part of the drawn stations */
+static void
+shuffle_promote(GvStationListPrivate *priv, GvStation *station)
+{
+	gboolean found;
+	guint i;
+
+	i = shuffle_position(priv, station, &found);
+	if (!found || i < priv->shuffled_drawn)
+		return;
+
+	shuffle_swap(priv, i, priv->shuffled_drawn);
+	priv->shuffled_drawn++;
+}
+
+/* Get rid of the holes */
+static void
+shuffle_compact(GvStationListPrivate *priv)
+{
+	GPtrArray *shuffled = priv->shuffled;
+	guint drawn = 0;
+	guint i, n;
+
+	for (i = 0, n = 0; i < shuffled->len; i++) {
+		GvStation *station = g_ptr_array_index(shuffled, i);
+
+		if (station == NULL)
+			continue;
+
+		if (i < priv->shuffled_drawn)
+			drawn++;
+
+		shuffle_set(priv, n++, station);
+	}
+
+	g_ptr_array_set_size(shuffled, n);
+	priv->shuffled_drawn = drawn;
+	priv->shuffled_holes = 0;
+}
+
+/* Forget about the previous draws, and start a new shuffle order */
+static void
+shuffle_reset(GvStationListPrivate *priv)
+{
+	shuffle_compact(priv);
+	priv->shuffled_drawn = 0;
+	priv->shuffled_wrap = NULL;
+}
+
+/* The station we wrapped around from, as long as it wasn't drawn again */
+static GvStation *
+shuffle_get_wrap(GvStationListPrivate *priv)
+{
+	GvStation *station = priv->shuffled_wrap;
+	gboolean found;
+	guint i;
+
+	if (station == NULL)
+		return NULL;
+
+	i = shuffle_position(priv, station, &found);
+	if (!found || i < priv->shuffled_drawn)
+		return NULL;
+
+	return station;
+}
+
+static void
+shuffle_add(GvStationListPrivate *priv, GvStation *station)
+{
+	if (priv->shuffled == NULL)
+		return;
+
+	g_ptr_array_add(priv->shuffled, NULL);
+	shuffle_set(priv, priv->shuffled->len - 1, station);
+}
+
+static void
+shuffle_remove(GvStationListPrivate *priv, GvStation *station)
+{
+	GPtrArray *shuffled = priv->shuffled;
+	gboolean found;
+	guint i;
+
+	if (shuffled == NULL)
+		return;
+
+	i = shuffle_position(priv, station, &found);
+	if (!found)
+		return;
+
+	g_hash_table_remove(priv->shuffled_pos, station);
+
+	if (priv->shuffled_wrap == station)
+		priv->shuffled_wrap = NULL;
+
+	if (i < priv->shuffled_drawn) {
+		/* Drawn part: leave a hole to preserve the order */
+		g_ptr_array_index(shuffled, i) = NULL;
+		priv->shuffled_holes++;
+		if (priv->shuffled_holes > shuffled->len / 2)
+			shuffle_compact(priv);
+	} else {
+		/* Undrawn part: order doesn't matter */
+		g_ptr_array_remove_index_fast(shuffled, i);
+		if (i < shuffled->len)
+			shuffle_set(priv, i, g_ptr_array_index(shuffled, i));
+	}
+}
+
+static void
+shuffle_free(GvStationListPrivate *priv)
+{
+	if (priv->shuffled == NULL)
+		return;
+
+	g_ptr_array_free(priv->shuffled, TRUE);
+	g_hash_table_destroy(priv->shuffled_pos);
+	priv->shuffled = NULL;
+	priv->shuffled_pos = NULL;
+	priv->shuffled_drawn = 0;
+	priv->shuffled_holes = 0;
+	priv->shuffled_wrap = NULL;
+}
+
+static void
+shuffle_new(GvStationListPrivate *priv)
+{
+	GSequenceIter *iter;
+	guint len;
+
+	if (priv->shuffled)
+		return;
+
+	len = g_sequence_get_length(priv->stations);
+	priv->shuffled = g_ptr_array_sized_new(len);
+	priv->shuffled_pos = g_hash_table_new(g_direct_hash, g_direct_equal);
+	priv->shuffled_drawn = 0;
+	priv->shuffled_holes = 0;
+
+	/* Nothing drawn yet, so order doesn't matter */
+	for (iter = g_sequence_get_begin_iter(priv->stations);
+	     !g_sequence_iter_is_end(iter);
+	     iter = g_sequence_iter_next(iter))
+		shuffle_add(priv, g_sequence_get(iter));
+}
+
+/* Return the first station at or after position i, drawing as needed */
+static GvStation *
+shuffle_forward(GvStationListPrivate *priv, guint i)
+{
+	g_assert(i <= priv->shuffled_drawn);
+
+	for (; i < priv->shuffled->len; i++) {
+		GvStation *station;
+
+		if (i == priv->shuffled_drawn)
+			shuffle_draw(priv);
+
+		station = g_ptr_array_index(priv->shuffled, i);
+		if (station)
+			return station;
+	}
+
+	return NULL;
+}
+
+/* Return the first station before position i, only among drawn stations */
+static GvStation *
+shuffle_backward(GvStationListPrivate *priv, guint i)
+{
+	g_assert(i <= priv->shuffled_drawn);
+
+	while (i > 0) {
+		GvStation *station;
+
+		station = g_ptr_array_index(priv->shuffled, --i);
+		if (station)
+			return station;
+	}
+
+	return NULL;
+}
+
+/*
+ * Lookup indexes
+ *
+ * Names and uris are not guaranteed to be unique (a station can be renamed
+ * to the name of another one), so these indexes map a key to an array of
+ * stations, ordered by insertion. Lookups return the first one. Uids are
+ * unique, so the uid index maps directly to a station.
+ */
+
+struct _GvStationKeys {
+	gchar *name;
+	gchar *uri;
+};
+
+typedef struct _GvStationKeys GvStationKeys;
+
+static void
+gv_station_keys_free(GvStationKeys *keys)
+{
+	g_free(keys->name);
+	g_free(keys->uri);
+	g_free(keys);
+}
+
+static void
+index_add(GHashTable *index, const gchar *key, GvStation *station)
+{
+	GPtrArray *stations;
+
+	if (key == NULL)
+		return;
+
+	stations = g_hash_table_lookup(index, key);
+	if (stations == NULL) {
+		stations = g_ptr_array_sized_new(1);
+		g_hash_table_insert(index, g_strdup(key), stations);
+	}
+
+	g_ptr_array_add(stations, station);
+}
+
+static void
+index_remove(GHashTable *index, const gchar *key, GvStation *station)
+{
+	GPtrArray *stations;
+
+	if (key == NULL)
+		return;
+
+	stations = g_hash_table_lookup(index, key);
+	if (stations == NULL)
+		return;
+
+	g_ptr_array_remove(stations, station);
+	if (stations->len == 0)
+		g_hash_table_remove(index, key);
+}
+
+static GvStation *
+index_lookup(GHashTable *index, const gchar *key)
+{
+	GPtrArray *stations;
+
+	stations = g_hash_table_lookup(index, key);
+	if (stations == NULL)
+		return NULL;
+
+	return g_ptr_array_index(stations, 0);
+}
+
+static void
+gv_station_list_index_station(GvStationList *self, GvStation *station)
+{
+	GvStationListPrivate *priv = self->priv;
+	GvStationKeys *keys;
+
+	keys = g_new0(GvStationKeys, 1);
+	keys->name = g_strdup(gv_station_get_name(station));
+	keys->uri = g_strdup(gv_station_get_uri(station));
+
+	index_add(priv->name_index, keys->name, station);
+	index_add(priv->uri_index, keys->uri, station);
+	g_hash_table_insert(priv->uid_index, (gpointer) gv_station_get_uid(station), station);
+	g_hash_table_insert(priv->indexed_keys, station, keys);
+}
+
+static void
+gv_station_list_unindex_station(GvStationList *self, GvStation *station)
+{
+	GvStationListPrivate *priv = self->priv;
+	GvStationKeys *keys;
+
+	keys = g_hash_table_lookup(priv->indexed_keys, station);
+	if (keys == NULL)
+		return;
+
+	index_remove(priv->name_index, keys->name, station);
+	index_remove(priv->uri_index, keys->uri, station);
+	g_hash_table_remove(priv->uid_index, gv_station_get_uid(station));
+	g_hash_table_remove(priv->indexed_keys, station);
+}
+
+static void
+gv_station_list_reindex_station(GvStationList *self, GvStation *station)
+{
+	GvStationListPrivate *priv = self->priv;
+	GvStationKeys *keys;
+	const gchar *name;
+	const gchar *uri;
+
+	keys = g_hash_table_lookup(priv->indexed_keys, station);
+	if (keys == NULL)
+		return;
+
+	name = gv_station_get_name(station);
+	if (g_strcmp0(keys->name, name)) {
+		index_remove(priv->name_index, keys->name, station);
+		g_free(keys->name);
+		keys->name = g_strdup(name);
+		index_add(priv->name_index, keys->name, station);
+	}
+
+	uri = gv_station_get_uri(station);
+	if (g_strcmp0(keys->uri, uri)) {
+		index_remove(priv->uri_index, keys->uri, station);
+		g_free(keys->uri);
+		keys->uri = g_strdup(uri);
+		index_add(priv->uri_index, keys->uri, station);
+	}
+}
+
+/*
+ * Save thread
+ */
+
+static gboolean
+when_idle_save_done(gpointer data)
+{
+	GvStationList *self = GV_STATION_LIST(data);
+	GvStationListPrivate *priv = self->priv;
+	GError *err;
+
+	g_mutex_lock(&priv->save_mutex);
+	err = priv->save_error;
+	priv->save_error = NULL;
+	priv->save_done_source_id = 0;
+	g_mutex_unlock(&priv->save_mutex);
+
+	/* Handle error. The journal can't be trusted anymore, so next edits
+	 * must trigger a full save.
+	 */
+	if (err == NULL) {
+		INFO("Station list saved to '%s'", priv->save_path);
+	} else {
+		WARNING("Failed to save station list: %s", err->message);
+		gv_errorable_emit_error(GV_ERRORABLE(self), _("%s: %s"),
+		                        _("Failed to save station list"), err->message);
+
+		g_error_free(err);
+		priv->journal_enabled = FALSE;
+	}
+
+	return G_SOURCE_REMOVE;
+}
+
+static void
+save_thread_close_journal(GvStationList *self)
+{
+	GvStationListPrivate *priv = self->priv;
+
+	if (priv->journal_file == NULL)
+		return;
+
+	fclose(priv->journal_file);
+	priv->journal_file = NULL;
+}
+
+static void
+save_thread_write_journal(GvStationList *self, const gchar *lines, GError **err)
+{
+	GvStationListPrivate *priv = self->priv;
+	const gchar *path = priv->journal_path;
+
+	/* No snapshot to start from, the journal is disabled */
+	if (priv->journal_base == NULL)
+		return;
+
+	/* Open the journal, and start it if it's a new file */
+	if (priv->journal_file == NULL) {
+		priv->journal_file = g_fopen(path, "a");
+		if (priv->journal_file == NULL)
+			goto error;
+
+		if (fseek(priv->journal_file, 0, SEEK_END) != 0)
+			goto error;
+
+		if (ftell(priv->journal_file) == 0) {
+			gchar *header;
+			int ret;
+
+			header = journal_print_header(priv->journal_base);
+			ret = fputs(header, priv->journal_file);
+			g_free(header);
+			if (ret == EOF)
+				goto error;
+		}
+	}
+
+	/* Append lines */
+	if (fputs(lines, priv->journal_file) == EOF)
+		goto error;
+
+	if (fflush(priv->journal_file) != 0)
+		goto error;
+
+	return;
+
+error:
+	g_set_error(err, G_FILE_ERROR, g_file_error_from_errno(errno),
+	            "Failed to write journal '%s': %s", path, g_strerror(errno));
+
+	/* Stop journaling, until the next snapshot */
+	save_thread_close_journal(self);
+	g_clear_pointer(&priv->journal_base, g_free);
+}
+
+static void
+save_thread_write_snapshot(GvStationList *self, GvSaveJob *job,
+                           const gchar *lines, GError **err)
+{
+	GvStationListPrivate *priv = self->priv;
+	gchar *header;
+	gchar *text;
+
+	/* The current journal is obsolete as soon as the snapshot is written */
+	save_thread_close_journal(self);
+	g_clear_pointer(&priv->journal_base, g_free);
+
+	/* Stringify data and write to file, atomically */
+	text = print_markup(job->records, err);
+	if (*err == NULL)
+		gv_file_write_sync(job->path, text, err);
+
+	if (*err) {
+		g_free(text);
+		return;
+	}
+
+	/* Start a new journal, with the lines recorded since the snapshot */
+	priv->journal_base = g_compute_checksum_for_string(G_CHECKSUM_SHA1, text, -1);
+	header = journal_print_header(priv->journal_base);
+	g_free(text);
+
+	text = g_strconcat(header, lines, NULL);
+	gv_file_write_sync(priv->journal_path, text, err);
+	if (*err) {
+		g_unlink(priv->journal_path);
+		g_clear_pointer(&priv->journal_base, g_free);
+	}
+
+	g_free(text);
+	g_free(header);
+
+	/* Refresh the cache */
+	save_thread_write_cache(self, job);
+}
+
+static void
+save_thread_write_cache(GvStationList *self, GvSaveJob *job)
+{
+	GvStationListPrivate *priv = self->priv;
+	GError *err = NULL;
+	GStatBuf file_stat;
+
+	/* The cache goes along the snapshot the journal starts from */
+	if (priv->journal_base == NULL)
+		return;
+
+	if (g_stat(job->path, &file_stat) != 0) {
+		WARNING("Failed to stat '%s': %s", job->path, g_strerror(errno));
+		return;
+	}
+
+	cache_write(priv->cache_path, job->records, priv->journal_base,
+	            &file_stat, &err);
+	if (err) {
+		WARNING("Failed to write station list cache: %s", err->message);
+		g_error_free(err);
+		return;
+	}
+
+	DEBUG("Station list cache written to '%s'", priv->cache_path);
+}
+
+static gpointer
+save_thread_func(gpointer data)
+{
+	GvStationList *self = GV_STATION_LIST(data);
+	GvStationListPrivate *priv = self->priv;
+
+	g_mutex_lock(&priv->save_mutex);
+
+	for (;;) {
+		GvSaveJob *job;
+		GError *err = NULL;
+		gchar *lines = NULL;
+		gboolean saved = FALSE;
+
+		/* Wait for a job, or for some journal lines */
+		while (priv->save_job == NULL && priv->journal_lines->len == 0 &&
+		       priv->save_quit == FALSE)
+			g_cond_wait(&priv->save_cond, &priv->save_mutex);
+
+		/* Pending work is always processed, even when quitting */
+		job = priv->save_job;
+		priv->save_job = NULL;
+
+		if (priv->journal_lines->len > 0) {
+			lines = g_string_free(priv->journal_lines, FALSE);
+			priv->journal_lines = g_string_new(NULL);
+		}
+
+		if (job == NULL && lines == NULL)
+			break;
+
+		g_mutex_unlock(&priv->save_mutex);
+
+		/* Lines that come along a job were recorded after the snapshot */
+		if (job && job->cache_only) {
+			save_thread_write_cache(self, job);
+			if (lines)
+				save_thread_write_journal(self, lines, &err);
+		} else if (job) {
+			save_thread_write_snapshot(self, job, lines, &err);
+			saved = TRUE;
+		} else {
+			save_thread_write_journal(self, lines, &err);
+		}
+
+		if (job)
+			gv_save_job_free(job);
+		g_free(lines);
+
+		g_mutex_lock(&priv->save_mutex);
+
+		/* Report the result in the main thread. Only the outcome of
+		 * the latest save matters, older errors are discarded.
+		 */
+		if (saved == FALSE && err == NULL)
+			continue;
+
+		g_clear_error(&priv->save_error);
+		priv->save_error = err;
+		if (priv->save_done_source_id == 0)
+			priv->save_done_source_id = g_idle_add(when_idle_save_done, self);
+	}
+
+	g_mutex_unlock(&priv->save_mutex);
+
+	return NULL;
+}
+
+static void
+gv_station_list_stop_save_thread(GvStationList *self)
+{
+	GvStationListPrivate *priv = self->priv;
+
+	if (priv->save_thread == NULL)
+		return;
+
+	/* Let the thread process the pending job, then wait for it */
+	g_mutex_lock(&priv->save_mutex);
+	priv->save_quit = TRUE;
+	g_cond_signal(&priv->save_cond);
+	g_mutex_unlock(&priv->save_mutex);
+
+	g_thread_join(priv->save_thread);
+	priv->save_thread = NULL;
+	save_thread_close_journal(self);
+
+	/* Report the result now, since it's too late for the main loop */
+	if (priv->save_done_source_id > 0) {
+		g_source_remove(priv->save_done_source_id);
+		priv->save_done_source_id = 0;
+
+		if (priv->save_error) {
+			WARNING("Failed to save station list: %s",
+			        priv->save_error->message);
+			g_clear_error(&priv->save_error);
+		} else {
+			INFO("Station list saved to '%s'", priv->save_path);
+		}
+	}
+}
+
+/* Must be called with the save mutex locked */
+static void
+gv_station_list_wake_save_thread(GvStationList *self)
+{
+	GvStationListPrivate *priv = self->priv;
+
+	if (priv->save_thread == NULL)
+		priv->save_thread = g_thread_new("station-list-save",
+		                                 save_thread_func, self);
+	else
+		g_cond_signal(&priv->save_cond);
+}
+
+/* Record an edit in the journal, takes ownership of the line */
+static void
+gv_station_list_journal_append(GvStationList *self, gchar *line)
+{
+	GvStationListPrivate *priv = self->priv;
+
+	if (priv->journal_enabled == FALSE) {
+		g_free(line);
+		return;
+	}
+
+	priv->journal_size += strlen(line);
+
+	g_mutex_lock(&priv->save_mutex);
+	g_string_append(priv->journal_lines, line);
+	gv_station_list_wake_save_thread(self);
+	g_mutex_unlock(&priv->save_mutex);
+
+	g_free(line);
+}
+
+/* Refresh the cache, given stations that match the station list file */
+static void
+gv_station_list_save_cache(GvStationList *self, GvSaveJob *job)
+{
+	GvStationListPrivate *priv = self->priv;
+
+	g_mutex_lock(&priv->save_mutex);
+
+	/* A pending save refreshes the cache anyway */
+	if (priv->save_job) {
+		gv_save_job_free(job);
+	} else {
+		priv->save_job = job;
+		gv_station_list_wake_save_thread(self);
+	}
+
+	g_mutex_unlock(&priv->save_mutex);
+
+	priv->cache_dirty = FALSE;
+}
+
+/*
+ * Batch handling
+ */
+
+static GPtrArray *
+hash_set_to_ptr_array(GHashTable *set)
+{
+	GHashTableIter iter;
+	GPtrArray *array;
+	gpointer key;
+
+	array = g_ptr_array_sized_new(g_hash_table_size(set));
+
+	g_hash_table_iter_init(&iter, set);
+	while (g_hash_table_iter_next(&iter, &key, NULL))
+		g_ptr_array_add(array, key);
+
+	return array;
+}
+
+/* Emit a per-station signal, or record the change if a batch is ongoing */
+static void
+gv_station_list_emit_station_signal(GvStationList *self, guint signal, GvStation *station)
+{
+	GvStationListPrivate *priv = self->priv;
+
+	if (priv->batch_depth == 0) {
+		g_signal_emit(self, signals[signal], 0, station);
+		return;
+	}
+
+	switch (signal) {
+	case SIGNAL_STATION_ADDED:
+		g_hash_table_remove(priv->batch_removed, station);
+		g_hash_table_add(priv->batch_added, station);
+		break;
+	case SIGNAL_STATION_REMOVED:
+		/* Added then removed within the batch: nothing happened */
+		if (g_hash_table_remove(priv->batch_added, station))
+			break;
+		g_hash_table_remove(priv->batch_moved, station);
+		g_hash_table_remove(priv->batch_modified, station);
+		/* Keep the station alive until the batch is committed */
+		g_hash_table_add(priv->batch_removed, g_object_ref(station));
+		break;
+	case SIGNAL_STATION_MOVED:
+		if (!g_hash_table_contains(priv->batch_added, station))
+			g_hash_table_add(priv->batch_moved, station);
+		break;
+	case SIGNAL_STATION_MODIFIED:
+		if (!g_hash_table_contains(priv->batch_added, station))
+			g_hash_table_add(priv->batch_modified, station);
+		break;
+	default:
+		ERROR("Unhandled signal: %u", signal);
+		/* Program execution stops here */
+		break;
+	}
+}
+
+/*
+ * Signal handlers
+ */
+
+static gboolean
+when_timeout_save_station_list(gpointer data)
+{
+	GvStationList *self = GV_STATION_LIST(data);
+	GvStationListPrivate *priv = self->priv;
+
+	gv_station_list_save(self);
+
+	priv->save_source_id = 0;
+
+	return G_SOURCE_REMOVE;
+}
+
+static void
+gv_station_list_save_delayed(GvStationList *self)
+{
+	GvStationListPrivate *priv = self->priv;
+
+	/* During a batch, the save is scheduled once at commit time */
+	if (priv->batch_depth > 0) {
+		priv->batch_needs_save = TRUE;
+		return;
+	}
+
+	/* Edits are already in the journal, the station list needs to be saved
+	 * only to compact it, when it becomes too big or too old.
+	 */
+	if (priv->journal_enabled && priv->journal_size < JOURNAL_MAX_SIZE) {
+		if (priv->save_source_id == 0)
+			priv->save_source_id =
+			        g_timeout_add_seconds(JOURNAL_MAX_AGE,
+			                              when_timeout_save_station_list, self);
+		return;
+	}
+
+	if (priv->save_source_id > 0)
+		g_source_remove(priv->save_source_id);
+
+	priv->save_source_id =
+	        g_timeout_add_seconds(SAVE_DELAY, when_timeout_save_station_list, self);
+}
+
+static void
+on_station_notify(GvStation     *station,
+                  GParamSpec     *pspec,
                   GvStationList *self)
 {
+	GvStationListPrivate *priv = self->priv;
 	const gchar *property_name = g_param_spec_get_name(pspec);
 
 	TRACE("%s, %s, %p", gv_station_get_uid(station), property_name, self);
 
-	/* We might want to save changes */
+	/* We might want to update indexes and save changes */
 	if (!g_strcmp0(property_name, "uri") ||
 	    !g_strcmp0(property_name, "name")) {
+		GSequenceIter *iter;
+
+		/* Positions are only right once the whole list is loaded */
+		gv_station_list_finish_load(self);
+
+		iter = gv_station_list_lookup_iter(self, station);
+		gv_station_list_reindex_station(self, station);
+		gv_station_list_journal_append(self, journal_print_station("modify",
+		                               g_sequence_iter_get_position(iter), station));
 		gv_station_list_save_delayed(self);
 	}
 
+	/* Learnt data only goes to the cache */
+	if (!g_strcmp0(property_name, "stream-uris") ||
+	    !g_strcmp0(property_name, "nominal-bitrate"))
+		priv->cache_dirty = TRUE;
+
 	/* Emit signal */
-	g_signal_emit(self, signals[SIGNAL_STATION_MODIFIED], 0, station);
+	gv_station_list_emit_station_signal(self, SIGNAL_STATION_MODIFIED, station);
 }
 
 /*
- * Public functions
+ * Staged load
  */
 
-void
-gv_station_list_remove(GvStationList *self, GvStation *station)
+static GSequenceIter *
+gv_station_list_load_station(GvStationList *self, guint i)
 {
 	GvStationListPrivate *priv = self->priv;
-	GList *item;
+	GvLoader *loader = priv->loader;
+	GSequenceIter *before_iter;
+	GSequenceIter *iter;
+	GvStation *station;
 
-	/* Ensure a valid station was given */
-	if (station == NULL) {
-		WARNING("Attempting to remove NULL station");
-		return;
+	/* Stations that come before the current station are inserted before it */
+	if (i < loader->current && loader->current_iter)
+		before_iter = loader->current_iter;
+	else
+		before_iter = g_sequence_get_end_iter(priv->stations);
+
+	/* Ownership of the station is transferred to the sequence */
+	station = gv_loader_get_station(loader, i);
+	iter = g_sequence_insert_before(before_iter, station);
+	g_hash_table_insert(priv->iters, station, iter);
+	priv->generation++;
+	gv_station_list_index_station(self, station);
+	g_signal_connect_object(station, "notify", G_CALLBACK(on_station_notify), self, 0);
+	shuffle_add(priv, station);
+
+	return iter;
+}
+
+static void
+gv_station_list_load_slice(GvStationList *self, guint n_stations)
+{
+	GvStationListPrivate *priv = self->priv;
+	GvLoader *loader = priv->loader;
+
+	while (n_stations > 0 && loader->next < loader->length) {
+		guint i = loader->next++;
+
+		if (i == loader->current)
+			continue;
+
+		gv_station_list_load_station(self, i);
+		n_stations--;
 	}
+}
 
-	/* Give info */
-	INFO("Removing station '%s'", gv_station_get_name_or_uri(station));
+static void
+gv_station_list_load_done(GvStationList *self)
+{
+	GvStationListPrivate *priv = self->priv;
 
-	/* Check that we own this station at first. If we don't find it
-	 * in our internal list, it's probably a programming error.
-	 */
-	item = g_list_find(priv->stations, station);
-	if (item == NULL) {
-		WARNING("GvStation %p (%s) not found in list",
-		        station, gv_station_get_uid(station));
+	/* Get rid of the loader */
+	gv_loader_free(priv->loader);
+	priv->loader = NULL;
+
+	/* Compact the journal if needed */
+	if (priv->journal_size > 0)
+		gv_station_list_save_delayed(self);
+
+	/* Dump the number of stations */
+	DEBUG("Station list has %u stations", gv_station_list_length(self));
+
+	/* Emit a signal to indicate that the list has been loaded */
+	g_signal_emit(self, signals[SIGNAL_LOADED], 0);
+}
+
+static gboolean
+when_idle_load_stations(gpointer data)
+{
+	GvStationList *self = GV_STATION_LIST(data);
+	GvStationListPrivate *priv = self->priv;
+	GvLoader *loader = priv->loader;
+
+	gv_station_list_load_slice(self, LOAD_SLICE_SIZE);
+
+	g_signal_emit(self, signals[SIGNAL_LOAD_PROGRESS], 0,
+	              gv_station_list_length(self), loader->length);
+
+	if (loader->next < loader->length)
+		return G_SOURCE_CONTINUE;
+
+	priv->load_source_id = 0;
+	gv_station_list_load_done(self);
+
+	return G_SOURCE_REMOVE;
+}
+
+/* Load the remaining stations right now. This is needed before modifying
+ * the station list, since positions must be right.
+ */
+static void
+gv_station_list_finish_load(GvStationList *self)
+{
+	GvStationListPrivate *priv = self->priv;
+	GvLoader *loader = priv->loader;
+
+	if (loader == NULL)
+		return;
+
+	DEBUG("Finishing load of the station list");
+
+	g_source_remove(priv->load_source_id);
+	priv->load_source_id = 0;
+
+	gv_station_list_load_slice(self, G_MAXUINT);
+
+	g_signal_emit(self, signals[SIGNAL_LOAD_PROGRESS], 0,
+	              gv_station_list_length(self), loader->length);
+
+	gv_station_list_load_done(self);
+}
+
+/*
+ * Snapshots
+ */
+
+static GvSnapshot *
+gv_snapshot_new(GvStationList *owner)
+{
+	GvStationListPrivate *priv = owner->priv;
+	GvSnapshot *snapshot;
+	GSequenceIter *iter;
+	guint i;
+
+	snapshot = g_new0(GvSnapshot, 1);
+	snapshot->owner = owner;
+	snapshot->ref_count = 1;
+	snapshot->generation = priv->generation;
+	snapshot->length = g_sequence_get_length(priv->stations);
+	snapshot->stations = g_new(GvStation *, snapshot->length);
+	snapshot->removed = g_ptr_array_new_with_free_func(g_object_unref);
+
+	for (i = 0, iter = g_sequence_get_begin_iter(priv->stations);
+	     !g_sequence_iter_is_end(iter);
+	     i++, iter = g_sequence_iter_next(iter))
+		snapshot->stations[i] = g_sequence_get(iter);
+
+	priv->snapshots = g_list_prepend(priv->snapshots, snapshot);
+
+	return snapshot;
+}
+
+static void
+gv_snapshot_unref(GvSnapshot *snapshot)
+{
+	GvStationList *owner = snapshot->owner;
+
+	snapshot->ref_count--;
+	if (snapshot->ref_count > 0)
 		return;
+
+	if (owner)
+		owner->priv->snapshots = g_list_remove(owner->priv->snapshots, snapshot);
+
+	g_ptr_array_free(snapshot->removed, TRUE);
+	g_free(snapshot->stations);
+	g_free(snapshot);
+}
+
+/* Keep a removed station alive, as long as a snapshot might refer to it */
+static void
+gv_station_list_keep_in_snapshots(GvStationList *self, GvStation *station)
+{
+	GvStationListPrivate *priv = self->priv;
+	GList *item;
+
+	for (item = priv->snapshots; item; item = item->next) {
+		GvSnapshot *snapshot = item->data;
+
+		g_ptr_array_add(snapshot->removed, g_object_ref(station));
 	}
+}
 
-	/* Disconnect signal handlers */
-	g_signal_handlers_disconnect_by_data(station, self);
+/*
+ * Private methods
+ */
 
-	/* Remove from list */
-	priv->stations = g_list_remove_link(priv->stations, item);
-	g_list_free(item);
+static GSequenceIter *
+gv_station_list_lookup_iter(GvStationList *self, GvStation *station)
+{
+	GvStationListPrivate *priv = self->priv;
 
-	/* Unown the station */
-	g_object_unref(station);
+	if (station == NULL)
+		return NULL;
+
+	return g_hash_table_lookup(priv->iters, station);
+}
 
-	/* Rebuild the shuffled station list */
-	if (priv->shuffled) {
-		g_list_free_full(priv->shuffled, g_object_unref);
-		priv->shuffled = g_list_copy_deep_shuffle(priv->stations,
-		                 (GCopyFunc) g_object_ref, NULL);
+/* Look for a station similar to the one given, thanks to the indexes.
+ * Two stations are similar if they have the same name, or the same uri.
+ */
+static GvStation *
+gv_station_list_find_similar(GvStationList *self, GvStation *station)
+{
+	GvStationListPrivate *priv = self->priv;
+	const gchar *uid = gv_station_get_uid(station);
+	const gchar *name = gv_station_get_name(station);
+	const gchar *uri = gv_station_get_uri(station);
+	GvStation *similar;
+
+	if (g_hash_table_contains(priv->iters, station)) {
+		WARNING("Station %p is already part of the list", station);
+		return station;
 	}
 
-	/* Emit a signal */
-	g_signal_emit(self, signals[SIGNAL_STATION_REMOVED], 0, station);
+	similar = g_hash_table_lookup(priv->uid_index, uid);
+	if (similar) {
+		WARNING("Stations %p and %p have the same uid '%s'", similar, station, uid);
+		return similar;
+	}
 
-	/* Save */
-	gv_station_list_save_delayed(self);
+	similar = name ? index_lookup(priv->name_index, name) : NULL;
+	if (similar) {
+		DEBUG("Stations %p and %p have the same name '%s'", similar, station, name);
+		return similar;
+	}
+
+	similar = uri ? index_lookup(priv->uri_index, uri) : NULL;
+	if (similar) {
+		DEBUG("Stations %p and %p have the same uri '%s'", similar, station, uri);
+		return similar;
+	}
+
+	return NULL;
 }
 
-void
-gv_station_list_insert(GvStationList *self, GvStation *station, gint pos)
+static void
+gv_station_list_insert_before_iter(GvStationList *self, GvStation *station,
+                                   GSequenceIter *before_iter)
 {
 	GvStationListPrivate *priv = self->priv;
-	GList *similar_item;
+	GSequenceIter *iter;
 
 	/* Ensure a valid station was given */
 	if (station == NULL) {
@@ -681,43 +2374,270 @@ gv_station_list_insert(GvStationList *self, GvStation *station, gint pos)
 		return;
 	}
 
+	/* Ensure the station list is fully loaded */
+	gv_station_list_finish_load(self);
+
 	/* Give info */
 	INFO("Inserting station '%s'", gv_station_get_name_or_uri(station));
 
 	/* Check that the station is not already part of the list.
 	 * Duplicates are a programming error, we must warn about that.
 	 * Identical fields are an user error.
-	 * Warnings and such are encapsulated in the GCompareFunc used
-	 * here, this is messy but temporary (hopefully).
+	 * Warnings and such are encapsulated in find_similar().
 	 */
-	similar_item = g_list_find_custom(priv->stations, station,
-	                                  (GCompareFunc) are_stations_similar);
-	if (similar_item)
+	if (gv_station_list_find_similar(self, station))
 		return;
 
 	/* Take ownership of the station */
 	g_object_ref_sink(station);
 
 	/* Add to the list at the right position */
-	priv->stations = g_list_insert(priv->stations, station, pos);
+	iter = g_sequence_insert_before(before_iter, station);
+	g_hash_table_insert(priv->iters, station, iter);
+	priv->generation++;
+
+	/* Add to indexes */
+	gv_station_list_index_station(self, station);
 
 	/* Connect to notify signal */
 	g_signal_connect_object(station, "notify", G_CALLBACK(on_station_notify), self, 0);
 
-	/* Rebuild the shuffled station list */
-	if (priv->shuffled) {
-		g_list_free_full(priv->shuffled, g_object_unref);
-		priv->shuffled = g_list_copy_deep_shuffle(priv->stations,
-		                 (GCopyFunc) g_object_ref, NULL);
+	/* Add to shuffle order */
+	shuffle_add(priv, station);
+
+	/* Record in journal */
+	gv_station_list_journal_append(self, journal_print_station("add",
+	                               g_sequence_iter_get_position(iter), station));
+
+	/* Emit a signal */
+	gv_station_list_emit_station_signal(self, SIGNAL_STATION_ADDED, station);
+
+	/* Save */
+	gv_station_list_save_delayed(self);
+}
+
+static void
+gv_station_list_move_before_iter(GvStationList *self, GvStation *station,
+                                 GSequenceIter *before_iter)
+{
+	GSequenceIter *iter;
+	guint from;
+
+	/* Ensure the station list is fully loaded */
+	gv_station_list_finish_load(self);
+
+	/* Find the station */
+	iter = gv_station_list_lookup_iter(self, station);
+	if (iter == NULL) {
+		WARNING("GvStation %p (%s) not found in list",
+		        station, gv_station_get_uid(station));
+		return;
+	}
+
+	/* Move it. Iterators remain valid after a move. */
+	from = g_sequence_iter_get_position(iter);
+	g_sequence_move(iter, before_iter);
+	self->priv->generation++;
+
+	/* Record in journal */
+	gv_station_list_journal_append(self, journal_print_move(from,
+	                               g_sequence_iter_get_position(iter)));
+
+	/* Emit a signal */
+	gv_station_list_emit_station_signal(self, SIGNAL_STATION_MOVED, station);
+
+	/* Save */
+	gv_station_list_save_delayed(self);
+}
+
+static GvStation *
+gv_station_list_shuffled_prev(GvStationList *self, GvStation *station, gboolean repeat)
+{
+	GvStationListPrivate *priv = self->priv;
+	GvStation *prev;
+	gboolean found;
+	guint pos;
+
+	/* Create shuffle order if needed */
+	shuffle_new(priv);
+
+	/* If the station list is empty, bail out */
+	if (priv->shuffled->len == priv->shuffled_holes)
+		return NULL;
+
+	/* Return last station for NULL argument */
+	if (station == NULL) {
+		shuffle_draw_all(priv);
+		return shuffle_backward(priv, priv->shuffled->len);
+	}
+
+	/* Try to find station in shuffle order */
+	shuffle_promote(priv, station);
+	pos = shuffle_position(priv, station, &found);
+	if (!found)
+		return NULL;
+
+	/* Return previous station if any */
+	prev = shuffle_backward(priv, pos);
+	if (prev)
+		return prev;
+
+	/* Without repeat, there's no more station */
+	if (!repeat)
+		return NULL;
+
+	/* Right after a wrap-around, go back to where we came from */
+	prev = shuffle_get_wrap(priv);
+	if (prev)
+		return prev;
+
+	/* With repeat, we re-shuffle once, then return the last station. We
+	 * make sure it's not the current station, by putting the current
+	 * station first. Once everything is drawn, the order is a cycle, and
+	 * asking again gives the same station.
+	 */
+	if (priv->shuffled_drawn < priv->shuffled->len) {
+		shuffle_reset(priv);
+		shuffle_promote(priv, station);
+		shuffle_draw_all(priv);
+	}
+
+	return shuffle_backward(priv, priv->shuffled->len);
+}
+
+static GvStation *
+gv_station_list_shuffled_next(GvStationList *self, GvStation *station, gboolean repeat)
+{
+	GvStationListPrivate *priv = self->priv;
+	GvStation *next;
+	gboolean found;
+	guint pos;
+
+	/* Create shuffle order if needed */
+	shuffle_new(priv);
+
+	/* If the station list is empty, bail out */
+	if (priv->shuffled->len == priv->shuffled_holes)
+		return NULL;
+
+	/* Return first station for NULL argument */
+	if (station == NULL)
+		return shuffle_forward(priv, 0);
+
+	/* Right after a wrap-around, give the same answer */
+	if (station == shuffle_get_wrap(priv))
+		return shuffle_forward(priv, 0);
+
+	/* Try to find station in shuffle order */
+	shuffle_promote(priv, station);
+	pos = shuffle_position(priv, station, &found);
+	if (!found)
+		return NULL;
+
+	/* Return next station if any */
+	next = shuffle_forward(priv, pos + 1);
+	if (next)
+		return next;
+
+	/* Without repeat, there's no more station */
+	if (!repeat)
+		return NULL;
+
+	/* With repeat, we re-shuffle lazily, then return the first station.
+	 * We make sure it's not the current station, by moving the current
+	 * station at the end, out of reach for the first draw.
+	 */
+	shuffle_reset(priv);
+
+	if (priv->shuffled->len == 1)
+		return station;
+
+	pos = shuffle_position(priv, station, &found);
+	shuffle_swap(priv, pos, priv->shuffled->len - 1);
+	shuffle_swap(priv, 0, g_random_int_range(0, priv->shuffled->len - 1));
+	priv->shuffled_drawn = 1;
+	priv->shuffled_wrap = station;
+
+	return g_ptr_array_index(priv->shuffled, 0);
+}
+
+/*
+ * Public functions
+ */
+
+void
+gv_station_list_remove(GvStationList *self, GvStation *station)
+{
+	GvStationListPrivate *priv = self->priv;
+	GSequenceIter *iter;
+
+	/* Ensure a valid station was given */
+	if (station == NULL) {
+		WARNING("Attempting to remove NULL station");
+		return;
+	}
+
+	/* Ensure the station list is fully loaded */
+	gv_station_list_finish_load(self);
+
+	/* Give info */
+	INFO("Removing station '%s'", gv_station_get_name_or_uri(station));
+
+	/* Check that we own this station at first. If we don't find it
+	 * in our internal list, it's probably a programming error.
+	 */
+	iter = gv_station_list_lookup_iter(self, station);
+	if (iter == NULL) {
+		WARNING("GvStation %p (%s) not found in list",
+		        station, gv_station_get_uid(station));
+		return;
 	}
 
+	/* Disconnect signal handlers */
+	g_signal_handlers_disconnect_by_data(station, self);
+
+	/* Remove from indexes */
+	gv_station_list_unindex_station(self, station);
+
+	/* Record in journal */
+	gv_station_list_journal_append(self, journal_print_remove
+	                               (g_sequence_iter_get_position(iter)));
+
+	/* Remove from list */
+	g_hash_table_remove(priv->iters, station);
+	g_sequence_remove(iter);
+	priv->generation++;
+	gv_station_list_keep_in_snapshots(self, station);
+
+	/* Remove from shuffle order */
+	shuffle_remove(priv, station);
+
 	/* Emit a signal */
-	g_signal_emit(self, signals[SIGNAL_STATION_ADDED], 0, station);
+	gv_station_list_emit_station_signal(self, SIGNAL_STATION_REMOVED, station);
+
+	/* Unown the station */
+	g_object_unref(station);
 
 	/* Save */
 	gv_station_list_save_delayed(self);
 }
 
+/* Insert a station at a given position.
+ * If 'pos' is negative or larger than the list, the station is appended.
+ */
+void
+gv_station_list_insert(GvStationList *self, GvStation *station, gint pos)
+{
+	GvStationListPrivate *priv = self->priv;
+	GSequenceIter *before_iter;
+
+	/* Positions are meaningful only once the station list is fully loaded */
+	gv_station_list_finish_load(self);
+
+	before_iter = g_sequence_get_iter_at_pos(priv->stations, pos);
+	gv_station_list_insert_before_iter(self, station, before_iter);
+}
+
 /* Insert a station before another.
  * If 'before' is NULL or is not found, the station is appended at the end of the list.
  */
@@ -725,10 +2645,13 @@ void
 gv_station_list_insert_before(GvStationList *self, GvStation *station, GvStation *before)
 {
 	GvStationListPrivate *priv = self->priv;
-	gint pos = -1;
+	GSequenceIter *before_iter;
+
+	before_iter = gv_station_list_lookup_iter(self, before);
+	if (before_iter == NULL)
+		before_iter = g_sequence_get_end_iter(priv->stations);
 
-	pos = g_list_index(priv->stations, before);
-	gv_station_list_insert(self, station, pos);
+	gv_station_list_insert_before_iter(self, station, before_iter);
 }
 
 /* Insert a station after another.
@@ -738,11 +2661,16 @@ void
 gv_station_list_insert_after(GvStationList *self, GvStation *station, GvStation *after)
 {
 	GvStationListPrivate *priv = self->priv;
-	gint pos = 0;
+	GSequenceIter *after_iter;
+	GSequenceIter *before_iter;
+
+	after_iter = gv_station_list_lookup_iter(self, after);
+	if (after_iter == NULL)
+		before_iter = g_sequence_get_begin_iter(priv->stations);
+	else
+		before_iter = g_sequence_iter_next(after_iter);
 
-	pos = g_list_index(priv->stations, after);
-	pos += 1; /* tricky but does what we want even for pos == -1 */
-	gv_station_list_insert(self, station, pos);
+	gv_station_list_insert_before_iter(self, station, before_iter);
 }
 
 void
@@ -757,54 +2685,61 @@ gv_station_list_append(GvStationList *self, GvStation *station)
 	gv_station_list_insert_before(self, station, NULL);
 }
 
+/* Move a station to a given position, the position being counted
+ * as if the station was first removed from the list.
+ * If 'pos' is negative or too large, the station is moved at the end of the list.
+ */
 void
 gv_station_list_move(GvStationList *self, GvStation *station, gint pos)
 {
 	GvStationListPrivate *priv = self->priv;
-	GList *item;
-
-	/* Find the station */
-	item = g_list_find(priv->stations, station);
-	if (item == NULL) {
-		WARNING("GvStation %p (%s) not found in list",
-		        station, gv_station_get_uid(station));
-		return;
-	}
+	GSequenceIter *iter;
+	GSequenceIter *before_iter;
 
-	/* Move it */
-	priv->stations = g_list_remove_link(priv->stations, item);
-	g_list_free(item);
-	priv->stations = g_list_insert(priv->stations, station, pos);
+	/* Positions are meaningful only once the station list is fully loaded */
+	gv_station_list_finish_load(self);
 
-	/* Emit a signal */
-	g_signal_emit(self, signals[SIGNAL_STATION_MOVED], 0, station);
+	iter = gv_station_list_lookup_iter(self, station);
+	if (iter && pos > g_sequence_iter_get_position(iter))
+		pos += 1; /* skip the station itself */
 
-	/* Save */
-	gv_station_list_save_delayed(self);
+	before_iter = g_sequence_get_iter_at_pos(priv->stations, pos);
+	gv_station_list_move_before_iter(self, station, before_iter);
 }
 
 /* Move a station before another.
- * If 'before' is NULL or not found, the station is inserted at the end of the list.
+ * If 'before' is NULL or not found, the station is moved at the end of the list.
  */
 void
 gv_station_list_move_before(GvStationList *self, GvStation *station, GvStation *before)
 {
 	GvStationListPrivate *priv = self->priv;
-	gint pos = -1;
+	GSequenceIter *before_iter;
+
+	before_iter = gv_station_list_lookup_iter(self, before);
+	if (before_iter == NULL)
+		before_iter = g_sequence_get_end_iter(priv->stations);
 
-	pos = g_list_index(priv->stations, before);
-	gv_station_list_move(self, station, pos);
+	gv_station_list_move_before_iter(self, station, before_iter);
 }
 
+/* Move a station after another.
+ * If 'after' is NULL or not found, the station is moved at the beginning of the list.
+ */
 void
 gv_station_list_move_after(GvStationList *self, GvStation *station, GvStation *after)
 {
 	GvStationListPrivate *priv = self->priv;
-	gint pos = 0;
+	GSequenceIter *after_iter;
+	GSequenceIter *before_iter;
+
+	after_iter = gv_station_list_lookup_iter(self, after);
+	if (after_iter == NULL)
+		before_iter = g_sequence_get_begin_iter(priv->stations);
+	else
+		before_iter = g_sequence_iter_next(after_iter);
 
-	pos = g_list_index(priv->stations, after);
-	pos += 1; /* tricky but does what we want even for pos == -1 */
-	gv_station_list_move(self, station, pos);
+	gv_station_list_move_before_iter(self, station, before_iter);
 }
 
 void
@@ -820,174 +2755,130 @@ gv_station_list_move_last(GvStationList *self, GvStation *station)
 }
 
 GvStation *
-gv_station_list_prev(GvStationList *self, GvStation *station,
-                     gboolean repeat, gboolean shuffle)
+gv_station_list_first(GvStationList *self)
 {
-	GvStationListPrivate *priv = self->priv;
-	GList *stations, *item;
-
-	/* Pickup the right station list, create shuffle list if needed */
-	if (shuffle) {
-		if (priv->shuffled == NULL) {
-			priv->shuffled = g_list_copy_deep_shuffle(priv->stations,
-			                 (GCopyFunc) g_object_ref, NULL);
-		}
-		stations = priv->shuffled;
-	} else {
-		if (priv->shuffled) {
-			g_list_free_full(priv->shuffled, g_object_unref);
-			priv->shuffled = NULL;
-		}
-		stations = priv->stations;
-	}
+	GSequence *stations = self->priv->stations;
 
-	/* If the station list is empty, bail out */
-	if (stations == NULL)
+	if (g_sequence_get_length(stations) == 0)
 		return NULL;
 
-	/* Return last station for NULL argument */
-	if (station == NULL)
-		return g_list_last(stations)->data;
+	return g_sequence_get(g_sequence_get_begin_iter(stations));
+}
 
-	/* Try to find station in station list */
-	item = g_list_find(stations, station);
-	if (item == NULL)
-		return NULL;
+GvStation *
+gv_station_list_last(GvStationList *self)
+{
+	GSequence *stations = self->priv->stations;
 
-	/* Return previous station if any */
-	item = item->prev;
-	if (item)
-		return item->data;
+	/* The last station might not be loaded yet */
+	gv_station_list_finish_load(self);
 
-	/* Without repeat, there's no more station */
-	if (!repeat)
+	if (g_sequence_get_length(stations) == 0)
 		return NULL;
 
-	/* With repeat, we may re-shuffle, then return the last station */
-	if (shuffle) {
-		GList *last_item;
-
-		stations = g_list_shuffle(priv->shuffled);
+	return g_sequence_get(g_sequence_iter_prev(g_sequence_get_end_iter(stations)));
+}
 
-		/* In case the last station (that we're about to return) happens to be
-		 * the same as the current station, we do a little a magic trick.
-		 */
-		last_item = g_list_last(stations);
-		if (last_item->data == station) {
-			stations = g_list_remove_link(stations, last_item);
-			stations = g_list_prepend(stations, last_item->data);
-			g_list_free(last_item);
-		}
+GvStation *
+gv_station_list_find(GvStationList *self, GvStation *station)
+{
+	GvStationListPrivate *priv = self->priv;
 
-		priv->shuffled = stations;
-	}
+	if (station == NULL)
+		return NULL;
 
-	return g_list_last(stations)->data;
+	return g_hash_table_contains(priv->iters, station) ? station : NULL;
 }
 
 GvStation *
-gv_station_list_next(GvStationList *self, GvStation *station,
+gv_station_list_prev(GvStationList *self, GvStation *station,
                      gboolean repeat, gboolean shuffle)
 {
 	GvStationListPrivate *priv = self->priv;
-	GList *stations, *item;
+	GSequenceIter *iter;
 
-	/* Pickup the right station list, create shuffle list if needed */
-	if (shuffle) {
-		if (priv->shuffled == NULL) {
-			priv->shuffled = g_list_copy_deep_shuffle(priv->stations,
-			                 (GCopyFunc) g_object_ref, NULL);
-		}
-		stations = priv->shuffled;
-	} else {
-		if (priv->shuffled) {
-			g_list_free_full(priv->shuffled, g_object_unref);
-			priv->shuffled = NULL;
-		}
-		stations = priv->stations;
-	}
+	/* Navigation needs the whole station list */
+	gv_station_list_finish_load(self);
+
+	/* Shuffle mode has its own list */
+	if (shuffle)
+		return gv_station_list_shuffled_prev(self, station, repeat);
+
+	/* Get rid of the shuffle order, if any */
+	shuffle_free(priv);
 
 	/* If the station list is empty, bail out */
-	if (stations == NULL)
+	if (g_sequence_get_length(priv->stations) == 0)
 		return NULL;
 
-	/* Return first station for NULL argument */
+	/* Return last station for NULL argument */
 	if (station == NULL)
-		return stations->data;
+		return gv_station_list_last(self);
 
 	/* Try to find station in station list */
-	item = g_list_find(stations, station);
-	if (item == NULL)
+	iter = gv_station_list_lookup_iter(self, station);
+	if (iter == NULL)
 		return NULL;
 
-	/* Return next station if any */
-	item = item->next;
-	if (item)
-		return item->data;
+	/* Return previous station if any */
+	if (!g_sequence_iter_is_begin(iter))
+		return g_sequence_get(g_sequence_iter_prev(iter));
 
 	/* Without repeat, there's no more station */
 	if (!repeat)
 		return NULL;
 
-	/* With repeat, we may re-shuffle, then return the first station */
-	if (shuffle) {
-		GList *first_item;
-
-		stations = g_list_shuffle(priv->shuffled);
-
-		/* In case the first station (that we're about to return) happens to be
-		 * the same as the current station, we do a little a magic trick.
-		 */
-		first_item = g_list_first(stations);
-		if (first_item->data == station) {
-			stations = g_list_remove_link(stations, first_item);
-			stations = g_list_append(stations, first_item->data);
-			g_list_free(first_item);
-		}
-
-		priv->shuffled = stations;
-	}
-
-	return stations->data;
+	/* With repeat, return the last station */
+	return gv_station_list_last(self);
 }
 
 GvStation *
-gv_station_list_first(GvStationList *self)
+gv_station_list_next(GvStationList *self, GvStation *station,
+                     gboolean repeat, gboolean shuffle)
 {
-	GList *stations = self->priv->stations;
+	GvStationListPrivate *priv = self->priv;
+	GSequenceIter *iter;
 
-	if (stations == NULL)
-		return NULL;
+	/* Navigation needs the whole station list */
+	gv_station_list_finish_load(self);
 
-	return g_list_first(stations)->data;
-}
+	/* Shuffle mode has its own list */
+	if (shuffle)
+		return gv_station_list_shuffled_next(self, station, repeat);
 
-GvStation *
-gv_station_list_last(GvStationList *self)
-{
-	GList *stations = self->priv->stations;
+	/* Get rid of the shuffle order, if any */
+	shuffle_free(priv);
 
-	if (stations == NULL)
+	/* If the station list is empty, bail out */
+	if (g_sequence_get_length(priv->stations) == 0)
 		return NULL;
 
-	return g_list_last(stations)->data;
-}
+	/* Return first station for NULL argument */
+	if (station == NULL)
+		return gv_station_list_first(self);
 
-GvStation *
-gv_station_list_find(GvStationList *self, GvStation *station)
-{
-	GList *stations = self->priv->stations;
-	GList *item;
+	/* Try to find station in station list */
+	iter = gv_station_list_lookup_iter(self, station);
+	if (iter == NULL)
+		return NULL;
+
+	/* Return next station if any */
+	iter = g_sequence_iter_next(iter);
+	if (!g_sequence_iter_is_end(iter))
+		return g_sequence_get(iter);
 
-	item = g_list_find(stations, station);
+	/* Without repeat, there's no more station */
+	if (!repeat)
+		return NULL;
 
-	return item ? item->data : NULL;
+	/* With repeat, return the first station */
+	return gv_station_list_first(self);
 }
 
 GvStation *
 gv_station_list_find_by_name(GvStationList *self, const gchar *name)
 {
-	GList *item;
+	GvStation *station;
 
 	/* Ensure station name is valid */
 	if (name == NULL) {
@@ -999,20 +2890,20 @@ gv_station_list_find_by_name(GvStationList *self, const gchar *name)
 	if (!g_strcmp0(name, ""))
 		return NULL;
 
-	/* Iterate on station list */
-	for (item = self->priv->stations; item; item = item->next) {
-		GvStation *station = item->data;
-		if (!g_strcmp0(name, gv_station_get_name(station)))
-			return station;
+	/* The station might not be loaded yet */
+	station = index_lookup(self->priv->name_index, name);
+	if (station == NULL && self->priv->loader) {
+		gv_station_list_finish_load(self);
+		station = index_lookup(self->priv->name_index, name);
 	}
 
-	return NULL;
+	return station;
 }
 
 GvStation *
 gv_station_list_find_by_uri(GvStationList *self, const gchar *uri)
 {
-	GList *item;
+	GvStation *station;
 
 	/* Ensure station name is valid */
 	if (uri == NULL) {
@@ -1020,20 +2911,20 @@ gv_station_list_find_by_uri(GvStationList *self, const gchar *uri)
 		return NULL;
 	}
 
-	/* Iterate on station list */
-	for (item = self->priv->stations; item; item = item->next) {
-		GvStation *station = item->data;
-		if (!g_strcmp0(uri, gv_station_get_uri(station)))
-			return station;
+	/* The station might not be loaded yet */
+	station = index_lookup(self->priv->uri_index, uri);
+	if (station == NULL && self->priv->loader) {
+		gv_station_list_finish_load(self);
+		station = index_lookup(self->priv->uri_index, uri);
 	}
 
-	return NULL;
+	return station;
 }
 
 GvStation *
 gv_station_list_find_by_uid(GvStationList *self, const gchar *uid)
 {
-	GList *item;
+	GvStation *station;
 
 	/* Ensure station name is valid */
 	if (uid == NULL) {
@@ -1041,14 +2932,14 @@ gv_station_list_find_by_uid(GvStationList *self, const gchar *uid)
 		return NULL;
 	}
 
-	/* Iterate on station list */
-	for (item = self->priv->stations; item; item = item->next) {
-		GvStation *station = item->data;
-		if (!g_strcmp0(uid, gv_station_get_uid(station)))
-			return station;
+	/* The station might not be loaded yet */
+	station = g_hash_table_lookup(self->priv->uid_index, uid);
+	if (station == NULL && self->priv->loader) {
+		gv_station_list_finish_load(self);
+		station = g_hash_table_lookup(self->priv->uid_index, uid);
 	}
 
-	return NULL;
+	return station;
 }
 
 GvStation  *
@@ -1061,73 +2952,212 @@ gv_station_list_find_by_guessing(GvStationList *self, const gchar *string)
 		return gv_station_list_find_by_name(self, string);
 }
 
-void
-gv_station_list_save(GvStationList *self)
+/* Import stations from a playlist file. Each stream of the playlist becomes
+ * a station, appended to the list, unless a station with the same uri
+ * already exists. Duplicates are counted, not imported. Stations are named
+ * after the stream titles, when the playlist gives some.
+ */
+gboolean
+gv_station_list_import(GvStationList *self, const gchar *path,
+                       guint *n_imported, guint *n_duplicates, GError **err)
 {
 	GvStationListPrivate *priv = self->priv;
-	GError *err = NULL;
-	gchar *text;
+	GvPlaylistFormat format;
+	GSList *streams, *titles;
+	GSList *item, *title;
+	gchar *text = NULL;
+	gchar *uri;
+	guint imported = 0;
+	guint duplicates = 0;
+
+	g_return_val_if_fail(path != NULL, FALSE);
+	g_return_val_if_fail(err == NULL || *err == NULL, FALSE);
+
+	/* Guess the playlist format from the file extension */
+	uri = g_filename_to_uri(path, NULL, err);
+	if (uri == NULL)
+		return FALSE;
 
-	/* Stringify data */
-	text = print_markup(priv->stations, &err);
-	if (err)
-		goto cleanup;
+	format = gv_playlist_get_format(uri);
+	g_free(uri);
+
+	if (format == GV_PLAYLIST_FORMAT_UNKNOWN) {
+		g_set_error(err, G_IO_ERROR, G_IO_ERROR_NOT_SUPPORTED,
+		            "Unsupported playlist format");
+		return FALSE;
+	}
 
-	/* Write to file */
-	gv_file_write_sync(priv->save_path, text, &err);
+	/* Read and parse */
+	if (!gv_file_read_sync(path, &text, err))
+		return FALSE;
 
-cleanup:
-	/* Cleanup */
+	streams = gv_playlist_parse(format, text, strlen(text), &titles);
 	g_free(text);
 
-	/* Handle error */
-	if (err == NULL) {
-		INFO("Station list saved to '%s'", priv->save_path);
-	} else {
-		WARNING("Failed to save station list: %s", err->message);
-		gv_errorable_emit_error(GV_ERRORABLE(self), _("%s: %s"),
-		                        _("Failed to save station list"), err->message);
+	/* Duplicates are looked up in the indexes, which requires the
+	 * whole station list to be loaded.
+	 */
+	gv_station_list_finish_load(self);
 
-		g_error_free(err);
+	/* Add stations, with a single change notification */
+	gv_station_list_begin_batch(self);
+
+	for (item = streams, title = titles; item; item = item->next, title = title->next) {
+		const gchar *stream_uri = item->data;
+		const gchar *name = title->data;
+		GvStation *station;
+
+		if (index_lookup(priv->uri_index, stream_uri)) {
+			DEBUG("Station '%s' already exists, not imported", stream_uri);
+			duplicates++;
+			continue;
+		}
+
+		/* Mirrors often share a title, but names must be unique */
+		if (name && index_lookup(priv->name_index, name)) {
+			DEBUG("Station name '%s' already exists, dropped", name);
+			name = NULL;
+		}
+
+		/* The list might still refuse the station */
+		station = g_object_ref_sink(gv_station_new(name, stream_uri));
+		gv_station_list_append(self, station);
+		if (gv_station_list_find(self, station))
+			imported++;
+		else
+			duplicates++;
+		g_object_unref(station);
 	}
+
+	gv_station_list_commit_batch(self);
+
+	g_slist_free_full(streams, g_free);
+	g_slist_free_full(titles, g_free);
+
+	INFO("Imported %u stations from '%s', %u duplicates skipped",
+	     imported, path, duplicates);
+
+	if (n_imported)
+		*n_imported = imported;
+	if (n_duplicates)
+		*n_duplicates = duplicates;
+
+	return TRUE;
 }
 
+/* Save the station list. The stations are copied right away, while the
+ * serialization and the write are done later on, in the save thread.
+ */
 void
-gv_station_list_load(GvStationList *self)
+gv_station_list_save(GvStationList *self)
 {
 	GvStationListPrivate *priv = self->priv;
-	GSList *item = NULL;
-	GList *sta_item;
+	GSequenceIter *iter;
+	GvSaveJob *job;
+
+	/* Never save a partially loaded station list */
+	gv_station_list_finish_load(self);
+
+	/* Snapshot data */
+	job = gv_save_job_new(priv->save_path, FALSE,
+	                      g_sequence_get_length(priv->stations));
+	for (iter = g_sequence_get_begin_iter(priv->stations);
+	     !g_sequence_iter_is_end(iter);
+	     iter = g_sequence_iter_next(iter))
+		gv_save_job_add_station(job, g_sequence_get(iter));
+
+	/* Hand it over to the save thread. If the previous job was not
+	 * processed yet, it's outdated, and just replaced. Same goes for
+	 * the journal lines not written yet.
+	 */
+	g_mutex_lock(&priv->save_mutex);
 
-	TRACE("%p", self);
+	if (priv->save_job) {
+		DEBUG("Pending save superseded");
+		gv_save_job_free(priv->save_job);
+	}
+	priv->save_job = job;
+	g_string_truncate(priv->journal_lines, 0);
 
-	/* This should be called only once at startup */
-	g_assert_null(priv->stations);
+	gv_station_list_wake_save_thread(self);
+
+	g_mutex_unlock(&priv->save_mutex);
+
+	/* The journal restarts from this snapshot */
+	priv->journal_enabled = TRUE;
+	priv->journal_size = 0;
+	priv->cache_dirty = FALSE;
+}
+
+static void
+markup_add_station_to_array(GvStation *station, gpointer user_data)
+{
+	GPtrArray *stations = user_data;
+
+	g_ptr_array_add(stations, station);
+}
+
+static gboolean
+load_markup_file(const gchar *path, GPtrArray *stations, GChecksum *checksum,
+                 GError **err)
+{
+	GFile *file;
+	GFileInputStream *stream;
+	gboolean ret;
+
+	file = g_file_new_for_path(path);
+	stream = g_file_read(file, NULL, err);
+	g_object_unref(file);
+
+	if (stream == NULL)
+		return FALSE;
+
+	ret = parse_markup(G_INPUT_STREAM(stream), checksum,
+	                   markup_add_station_to_array, stations, err);
+	g_object_unref(stream);
+
+	return ret;
+}
+
+/* Load stations from the first valid station list file, or fallback to
+ * the default. If the stations come from the user file, 'base' is set
+ * to the checksum of this file.
+ */
+static GPtrArray *
+gv_station_list_load_markup(GvStationList *self, gchar **base)
+{
+	GvStationListPrivate *priv = self->priv;
+	GSList *item = NULL;
+	GPtrArray *stations;
+
+	stations = g_ptr_array_new_with_free_func(g_object_unref);
 
 	/* Load from a list of pathes */
 	for (item = priv->load_pathes; item; item = item->next) {
 		GError *err = NULL;
 		const gchar *path = item->data;
-		gchar *text;
+		GChecksum *checksum = NULL;
 
-		/* Attempt to read file */
-		gv_file_read_sync(path, &text, &err);
-		if (err) {
-			WARNING("%s", err->message);
-			g_clear_error(&err);
-			continue;
-		}
+		/* Checksum is needed only for the user file */
+		if (!g_strcmp0(path, priv->save_path))
+			checksum = g_checksum_new(G_CHECKSUM_SHA1);
 
-		/* Attempt to parse it */
-		priv->stations = parse_markup(text, &err);
-		g_free(text);
+		/* Attempt to read and parse it */
+		load_markup_file(path, stations, checksum, &err);
 		if (err) {
-			WARNING("Failed to parse '%s': %s", path, err->message);
+			WARNING("Failed to load '%s': %s", path, err->message);
 			g_clear_error(&err);
+			g_ptr_array_set_size(stations, 0);
+			if (checksum)
+				g_checksum_free(checksum);
 			continue;
 		}
 
 		/* Success */
+		if (checksum) {
+			*base = g_strdup(g_checksum_get_string(checksum));
+			g_checksum_free(checksum);
+		}
 		break;
 	}
 
@@ -1137,29 +3167,195 @@ gv_station_list_load(GvStationList *self)
 
 		INFO("Station list loaded from file '%s'", loaded_path);
 	} else {
+		GInputStream *stream;
 		GError *err = NULL;
 
 		INFO("No valid station list file found, using hard-coded default");
 
-		priv->stations = parse_markup(DEFAULT_STATION_LIST, &err);
+		stream = g_memory_input_stream_new_from_data(DEFAULT_STATION_LIST, -1, NULL);
+		parse_markup(stream, NULL, markup_add_station_to_array, stations, &err);
+		g_object_unref(stream);
 		if (err) {
 			ERROR("%s", err->message);
 			/* Program execution stops here */
 		}
 	}
 
-	/* Dump the number of stations */
-	DEBUG("Station list has %u stations", gv_station_list_length(self));
+	return stations;
+}
+
+/* Load the station list. The current station and the first stations are
+ * loaded right away, then the remaining stations are loaded in idle slices,
+ * and the signal 'loaded' is emitted at the end. Modifying the station list,
+ * or looking for a station that is not loaded yet, completes the load.
+ */
+void
+gv_station_list_load(GvStationList *self)
+{
+	GvStationListPrivate *priv = self->priv;
+	GvCache *cache = NULL;
+	GPtrArray *stations = NULL;
+	GvLoader *loader;
+	gchar *journal = NULL;
+	gchar *base = NULL;
+	gchar *current_uri;
+	guint i;
+
+	TRACE("%p", self);
+
+	/* This should be called only once at startup */
+	g_assert(g_sequence_get_length(priv->stations) == 0);
+	g_assert(priv->save_thread == NULL);
 
-	/* Register a notify handler for each station */
-	for (sta_item = priv->stations; sta_item; sta_item = sta_item->next) {
-		GvStation *station = sta_item->data;
+	/* Load from the cache if it's up to date, otherwise from the files.
+	 * The save thread gets its own copy of the base.
+	 */
+	cache = cache_open(priv->cache_path, priv->save_path);
+	if (cache) {
+		INFO("Station list loaded from cache '%s'", priv->cache_path);
+		base = g_strdup(cache_get_base(cache));
+		priv->journal_base = g_strdup(base);
+	} else {
+		stations = gv_station_list_load_markup(self, &base);
 
-		g_signal_connect_object(station, "notify", G_CALLBACK(on_station_notify), self, 0);
+		/* Refresh the cache, if the stations come from the user file */
+		priv->journal_base = g_strdup(base);
+		if (base) {
+			GvSaveJob *job;
+
+			job = gv_save_job_new(priv->save_path, TRUE, stations->len);
+			for (i = 0; i < stations->len; i++)
+				gv_save_job_add_station(job, g_ptr_array_index(stations, i));
+			gv_station_list_save_cache(self, job);
+		}
 	}
 
-	/* Emit a signal to indicate that the list has been loaded */
-	g_signal_emit(self, signals[SIGNAL_LOADED], 0);
+	/* Read the journal, if the station list was loaded from the user file */
+	if (base) {
+		GError *err = NULL;
+
+		priv->journal_enabled = TRUE;
+
+		gv_file_read_sync(priv->journal_path, &journal, &err);
+		if (err) {
+			if (!g_error_matches(err, G_FILE_ERROR, G_FILE_ERROR_NOENT))
+				WARNING("%s", err->message);
+			g_clear_error(&err);
+		}
+	}
+
+	/* Replay the journal. It applies to the whole snapshot, so stations
+	 * must all be read from the cache at first. A corrupted journal can't
+	 * be appended to, it must be compacted asap.
+	 */
+	if (journal) {
+		if (cache) {
+			stations = g_ptr_array_new_full(cache_get_length(cache), g_object_unref);
+			for (i = 0; i < cache_get_length(cache); i++)
+				g_ptr_array_add(stations, cache_get_station(cache, i));
+			cache_close(cache);
+			cache = NULL;
+		}
+
+		priv->journal_size = strlen(journal);
+		if (journal_replay(journal, base, stations) == FALSE)
+			priv->journal_enabled = FALSE;
+
+		g_free(journal);
+	}
+
+	g_free(base);
+
+	/* Load the current station and the first stations right now */
+	loader = priv->loader = gv_loader_new(cache, stations);
+
+	current_uri = g_settings_get_string(gv_core_settings, "station-uri");
+	if (current_uri && current_uri[0] != '\0')
+		loader->current = gv_loader_find_by_uri(loader, current_uri);
+	g_free(current_uri);
+
+	if (loader->current < LOAD_FIRST_SLICE_SIZE)
+		loader->current = G_MAXUINT;
+
+	gv_station_list_load_slice(self, LOAD_FIRST_SLICE_SIZE);
+	if (loader->current != G_MAXUINT)
+		loader->current_iter = gv_station_list_load_station(self, loader->current);
+
+	DEBUG("Station list has %u stations loaded out of %u",
+	      gv_station_list_length(self), loader->length);
+
+	/* Load the remaining stations in the background */
+	if (loader->next < loader->length) {
+		g_signal_emit(self, signals[SIGNAL_LOAD_PROGRESS], 0,
+		              gv_station_list_length(self), loader->length);
+		priv->load_source_id = g_idle_add(when_idle_load_stations, self);
+	} else {
+		gv_station_list_load_done(self);
+	}
+}
+
+/* Start a batch of changes. Until the batch is committed, the per-station
+ * signals are not emitted, the changes are recorded instead. Batches can be
+ * nested, only the outermost commit has an effect.
+ */
+void
+gv_station_list_begin_batch(GvStationList *self)
+{
+	GvStationListPrivate *priv = self->priv;
+
+	priv->batch_depth++;
+}
+
+/* Commit a batch of changes. If anything changed, the signal 'changed' is
+ * emitted once with a summary of the changes, and a save is scheduled.
+ */
+void
+gv_station_list_commit_batch(GvStationList *self)
+{
+	GvStationListPrivate *priv = self->priv;
+	GvStationListChanges changes;
+	gboolean needs_save;
+
+	g_return_if_fail(priv->batch_depth > 0);
+
+	priv->batch_depth--;
+	if (priv->batch_depth > 0)
+		return;
+
+	needs_save = priv->batch_needs_save;
+	priv->batch_needs_save = FALSE;
+
+	/* Emit a signal if something changed */
+	if (g_hash_table_size(priv->batch_added) > 0 ||
+	    g_hash_table_size(priv->batch_removed) > 0 ||
+	    g_hash_table_size(priv->batch_moved) > 0 ||
+	    g_hash_table_size(priv->batch_modified) > 0) {
+		changes.added = hash_set_to_ptr_array(priv->batch_added);
+		changes.removed = hash_set_to_ptr_array(priv->batch_removed);
+		changes.moved = hash_set_to_ptr_array(priv->batch_moved);
+		changes.modified = hash_set_to_ptr_array(priv->batch_modified);
+
+		DEBUG("Batch committed: %u added, %u removed, %u moved, %u modified",
+		      changes.added->len, changes.removed->len,
+		      changes.moved->len, changes.modified->len);
+
+		g_signal_emit(self, signals[SIGNAL_CHANGED], 0, &changes);
+
+		g_ptr_array_free(changes.added, TRUE);
+		g_ptr_array_free(changes.removed, TRUE);
+		g_ptr_array_free(changes.moved, TRUE);
+		g_ptr_array_free(changes.modified, TRUE);
+	}
+
+	/* Release recorded changes (and the removed stations along) */
+	g_hash_table_remove_all(priv->batch_added);
+	g_hash_table_remove_all(priv->batch_removed);
+	g_hash_table_remove_all(priv->batch_moved);
+	g_hash_table_remove_all(priv->batch_modified);
+
+	/* Save once */
+	if (needs_save)
+		gv_station_list_save_delayed(self);
 }
 
 guint
@@ -1167,7 +3363,7 @@ gv_station_list_length(GvStationList *self)
 {
 	GvStationListPrivate *priv = self->priv;
 
-	return g_list_length(priv->stations);
+	return g_sequence_get_length(priv->stations);
 }
 
 GvStationList *
@@ -1185,31 +3381,96 @@ gv_station_list_finalize(GObject *object)
 {
 	GvStationList *self = GV_STATION_LIST(object);
 	GvStationListPrivate *priv = self->priv;
-	GList *item;
+	GSequenceIter *iter;
 
 	TRACE("%p", object);
 
-	/* Run any pending save operation */
-	if (priv->save_source_id > 0)
+	/* Complete the load, if needed, so that nothing is lost when saving */
+	if (priv->loader) {
+		g_source_remove(priv->load_source_id);
+		gv_station_list_load_slice(self, G_MAXUINT);
+		gv_loader_free(priv->loader);
+		priv->loader = NULL;
+	}
+
+	/* Run any pending save operation, and wait for it to complete.
+	 * Otherwise, the station list file is up to date, but the cache
+	 * might need to be refreshed with what was learnt.
+	 */
+	if (priv->save_source_id > 0) {
+		g_source_remove(priv->save_source_id);
 		when_timeout_save_station_list(self);
+	} else if (priv->cache_dirty && priv->journal_enabled) {
+		GvSaveJob *job;
+
+		job = gv_save_job_new(priv->save_path, TRUE,
+		                      g_sequence_get_length(priv->stations));
+		for (iter = g_sequence_get_begin_iter(priv->stations);
+		     !g_sequence_iter_is_end(iter);
+		     iter = g_sequence_iter_next(iter))
+			gv_save_job_add_station(job, g_sequence_get(iter));
+		gv_station_list_save_cache(self, job);
+	}
 
-	/* Free shuffled station list */
-	g_list_free_full(priv->shuffled, g_object_unref);
+	gv_station_list_stop_save_thread(self);
+	g_cond_clear(&priv->save_cond);
+	g_mutex_clear(&priv->save_mutex);
+	g_string_free(priv->journal_lines, TRUE);
+	g_free(priv->journal_base);
+
+	/* Free snapshots. Iterators are not supposed to outlive the list. */
+	g_clear_pointer(&priv->snapshot, gv_snapshot_unref);
+	if (priv->snapshots) {
+		GList *item;
+
+		WARNING("%u station list snapshots still alive !",
+		        g_list_length(priv->snapshots));
+		for (item = priv->snapshots; item; item = item->next) {
+			GvSnapshot *snapshot = item->data;
+
+			snapshot->owner = NULL;
+		}
+		g_list_free(priv->snapshots);
+	}
+
+	/* Free shuffle order */
+	shuffle_free(priv);
+
+	/* Free indexes */
+	g_hash_table_destroy(priv->indexed_keys);
+	g_hash_table_destroy(priv->uid_index);
+	g_hash_table_destroy(priv->uri_index);
+	g_hash_table_destroy(priv->name_index);
+	g_hash_table_destroy(priv->iters);
+
+	/* Free batch changes */
+	g_hash_table_destroy(priv->batch_modified);
+	g_hash_table_destroy(priv->batch_moved);
+	g_hash_table_destroy(priv->batch_removed);
+	g_hash_table_destroy(priv->batch_added);
 
 	/* Free station list and ensure no memory is leaked. This works only if the
 	 * station list is the last object to hold references to stations. In other
 	 * words, the station list must be the last object finalized.
 	 */
-	for (item = priv->stations; item; item = item->next) {
-		g_object_add_weak_pointer(G_OBJECT(item->data), &(item->data));
-		g_object_unref(item->data);
-		if (item->data != NULL)
+	for (iter = g_sequence_get_begin_iter(priv->stations);
+	     !g_sequence_iter_is_end(iter);
+	     iter = g_sequence_iter_next(iter)) {
+		GvStation *station = g_sequence_get(iter);
+
+		g_object_add_weak_pointer(G_OBJECT(station), (gpointer *) &station);
+		g_object_unref(station);
+		if (station != NULL) {
 			WARNING("Station '%s' has not been finalized !",
-			        gv_station_get_name_or_uri(GV_STATION(item->data)));
+			        gv_station_get_name_or_uri(station));
+			g_object_remove_weak_pointer(G_OBJECT(station), (gpointer *) &station);
+		}
 	}
-	g_list_free(priv->stations);
+	g_sequence_free(priv->stations);
 
 	/* Free pathes */
+	g_free(priv->cache_path);
+	g_free(priv->journal_path);
 	g_free(priv->save_path);
 	g_slist_free_full(priv->load_pathes, g_free);
 
@@ -1227,6 +3488,8 @@ gv_station_list_constructed(GObject *object)
 	priv->load_pathes = gv_get_existing_path_list
 	                    (GV_DIR_USER_CONFIG | GV_DIR_SYSTEM_CONFIG, "stations");
 	priv->save_path = g_build_filename(gv_get_user_config_dir(), "stations", NULL);
+	priv->journal_path = g_build_filename(gv_get_user_config_dir(), "stations.journal", NULL);
+	priv->cache_path = g_build_filename(gv_get_user_cache_dir(), "stations.cache", NULL);
 
 	/* Chain up */
 	G_OBJECT_CHAINUP_CONSTRUCTED(gv_station_list, object);
@@ -1239,6 +3502,31 @@ gv_station_list_init(GvStationList *self)
 
 	/* Initialize private pointer */
 	self->priv = gv_station_list_get_instance_private(self);
+
+	/* Initialize save thread data */
+	g_mutex_init(&self->priv->save_mutex);
+	g_cond_init(&self->priv->save_cond);
+	self->priv->journal_lines = g_string_new(NULL);
+
+	/* Initialize station list */
+	self->priv->stations = g_sequence_new(NULL);
+	self->priv->iters = g_hash_table_new(g_direct_hash, g_direct_equal);
+
+	/* Initialize indexes */
+	self->priv->name_index = g_hash_table_new_full(g_str_hash, g_str_equal, g_free,
+	                         (GDestroyNotify) g_ptr_array_unref);
+	self->priv->uri_index = g_hash_table_new_full(g_str_hash, g_str_equal, g_free,
+	                        (GDestroyNotify) g_ptr_array_unref);
+	self->priv->uid_index = g_hash_table_new(g_str_hash, g_str_equal);
+	self->priv->indexed_keys = g_hash_table_new_full(g_direct_hash, g_direct_equal, NULL,
+	                           (GDestroyNotify) gv_station_keys_free);
+
+	/* Initialize batch changes */
+	self->priv->batch_added = g_hash_table_new(g_direct_hash, g_direct_equal);
+	self->priv->batch_removed = g_hash_table_new_full(g_direct_hash, g_direct_equal,
+	                            g_object_unref, NULL);
+	self->priv->batch_moved = g_hash_table_new(g_direct_hash, g_direct_equal);
+	self->priv->batch_modified = g_hash_table_new(g_direct_hash, g_direct_equal);
 }
 
 static void
@@ -1258,6 +3546,14 @@ gv_station_list_class_init(GvStationListClass *class)
 	                     G_SIGNAL_RUN_LAST, 0, NULL, NULL, NULL,
 			     G_TYPE_NONE, 0);
 
+	/* Emitted during a staged load, with the number of stations loaded
+	 * so far, and the total number of stations.
+	 */
+	signals[SIGNAL_LOAD_PROGRESS] =
+	        g_signal_new("load-progress", G_TYPE_FROM_CLASS(class),
+	                     G_SIGNAL_RUN_LAST, 0, NULL, NULL, NULL,
+			     G_TYPE_NONE, 2, G_TYPE_UINT, G_TYPE_UINT);
+
 	signals[SIGNAL_STATION_ADDED] =
 	        g_signal_new("station-added", G_TYPE_FROM_CLASS(class),
 	                     G_SIGNAL_RUN_LAST, 0, NULL, NULL, NULL,
@@ -1277,4 +3573,12 @@ gv_station_list_class_init(GvStationListClass *class)
 	        g_signal_new("station-moved", G_TYPE_FROM_CLASS(class),
 	                     G_SIGNAL_RUN_LAST, 0, NULL, NULL, NULL,
 			     G_TYPE_NONE, 1, G_TYPE_OBJECT);
+
+	/* Emitted once per batch, instead of the per-station signals above.
+	 * The argument is a GvStationListChanges, valid during emission only.
+	 */
+	signals[SIGNAL_CHANGED] =
+	        g_signal_new("changed", G_TYPE_FROM_CLASS(class),
+	                     G_SIGNAL_RUN_LAST, 0, NULL, NULL, NULL,
+			     G_TYPE_NONE, 1, G_TYPE_POINTER);
 }
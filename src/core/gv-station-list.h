@@ -36,6 +36,16 @@ G_DECLARE_FINAL_TYPE(GvStationList, gv_station_list, GV, STATION_LIST, GObject)
 
 typedef struct _GvStationListIter GvStationListIter;
 
+/* Changes made during a batch, passed along the 'changed' signal */
+struct _GvStationListChanges {
+	GPtrArray *added;
+	GPtrArray *removed;
+	GPtrArray *moved;
+	GPtrArray *modified;
+};
+
+typedef struct _GvStationListChanges GvStationListChanges;
+
 /* Methods */
 
 GvStationList *gv_station_list_new (void);
@@ -44,6 +54,12 @@ void  gv_station_list_load  (GvStationList *self);
 void  gv_station_list_save  (GvStationList *self);
 guint gv_station_list_length(GvStationList *self);
 
+gboolean gv_station_list_import(GvStationList *self, const gchar *path,
+                                guint *n_imported, guint *n_duplicates, GError **err);
+
+void gv_station_list_begin_batch (GvStationList *self);
+void gv_station_list_commit_batch(GvStationList *self);
+
 void gv_station_list_prepend      (GvStationList *self, GvStation *station);
 void gv_station_list_append       (GvStationList *self, GvStation *station);
 void gv_station_list_insert       (GvStationList *self, GvStation *station, gint position);
@@ -83,6 +83,15 @@ struct _GvStationPrivate {
 	/* Learnt along the way */
 	GSList *stream_uris;
 	guint   nominal_bitrate;
+
+	/*
+	 * Private data
+	 */
+
+	/* Playlist download in progress */
+	GvPlaylist *playlist;
+	/* Stream uri that worked last time */
+	gchar      *preferred_stream_uri;
 };
 
 typedef struct _GvStationPrivate GvStationPrivate;
@@ -100,17 +109,17 @@ G_DEFINE_TYPE_WITH_PRIVATE(GvStation, gv_station, G_TYPE_INITIALLY_UNOWNED)
  * Helpers
  */
 
-static void
-gv_station_set_stream_uris(GvStation *self, GSList *list)
+static gboolean
+stream_uris_equal(GSList *a, GSList *b)
 {
-	GvStationPrivate *priv = self->priv;
-
-	if (priv->stream_uris)
-		g_slist_free_full(priv->stream_uris, g_free);
-
-	priv->stream_uris = g_slist_copy_deep(list, (GCopyFunc) g_strdup, NULL);
+	while (a && b) {
+		if (g_strcmp0(a->data, b->data))
+			return FALSE;
+		a = a->next;
+		b = b->next;
+	}
 
-	g_object_notify(G_OBJECT(self), "stream-uris");
+	return a == b;
 }
 
 static void
@@ -132,10 +141,19 @@ on_playlist_downloaded(GvPlaylist *playlist,
 {
 	GSList *streams;
 
+	/* Results of an outdated download are discarded */
+	if (playlist != self->priv->playlist)
+		return;
+
+	/* The playlist might be notified twice, first from the cache,
+	 * then after revalidation. Only notify if something changed.
+	 */
 	streams = gv_playlist_get_stream_list(playlist);
-	gv_station_set_stream_uris(self, streams);
+	if (streams == NULL ||
+	    stream_uris_equal(streams, self->priv->stream_uris))
+		return;
 
-	g_object_unref(playlist);
+	gv_station_set_stream_uris(self, streams);
 }
 
 /*
@@ -208,9 +226,13 @@ gv_station_set_uri(GvStation *self, const gchar *uri)
 	g_free(priv->uri);
 	priv->uri = g_strdup(uri);
 
-	/* If this is not a playlist uri, then it's a stream uri */
-	if (gv_playlist_get_format(uri) == GV_PLAYLIST_FORMAT_UNKNOWN)
+	/* If this is a stream uri, no need to download anything. Otherwise,
+	 * the stream uris are known after the uri was downloaded once.
+	 */
+	if (gv_playlist_is_stream_uri(uri))
 		gv_station_set_stream_uri(self, uri);
+	else if (priv->stream_uris)
+		gv_station_set_stream_uris(self, NULL);
 
 	/* Notify */
 	g_object_notify_by_pspec(G_OBJECT(self), properties[PROP_URI]);
@@ -253,6 +275,50 @@ gv_station_get_stream_uris(GvStation *self)
 	return self->priv->stream_uris;
 }
 
+/* Stream uris are learnt along the way, but can also be restored */
+void
+gv_station_set_stream_uris(GvStation *self, GSList *list)
+{
+	GvStationPrivate *priv = self->priv;
+
+	if (priv->stream_uris)
+		g_slist_free_full(priv->stream_uris, g_free);
+
+	priv->stream_uris = g_slist_copy_deep(list, (GCopyFunc) g_strdup, NULL);
+
+	g_object_notify(G_OBJECT(self), "stream-uris");
+}
+
+/* The preferred stream uri is not a property, it's only a hint for the
+ * engine, and changing it doesn't need to be notified.
+ */
+
+const gchar *
+gv_station_get_preferred_stream_uri(GvStation *self)
+{
+	GvStationPrivate *priv = self->priv;
+
+	/* Only valid if it's still one of the stream uris */
+	if (priv->preferred_stream_uri &&
+	    g_slist_find_custom(priv->stream_uris, priv->preferred_stream_uri,
+	                        (GCompareFunc) g_strcmp0))
+		return priv->preferred_stream_uri;
+
+	return gv_station_get_first_stream_uri(self);
+}
+
+void
+gv_station_set_preferred_stream_uri(GvStation *self, const gchar *uri)
+{
+	GvStationPrivate *priv = self->priv;
+
+	if (!g_strcmp0(priv->preferred_stream_uri, uri))
+		return;
+
+	g_free(priv->preferred_stream_uri);
+	priv->preferred_stream_uri = g_strdup(uri);
+}
+
 const gchar *
 gv_station_get_first_stream_uri(GvStation *self)
 {
@@ -362,19 +428,43 @@ gv_station_download_playlist(GvStation *self)
 		return FALSE;
 	}
 
-	if (gv_playlist_get_format(priv->uri) == GV_PLAYLIST_FORMAT_UNKNOWN) {
+	if (gv_playlist_is_stream_uri(priv->uri)) {
 		WARNING("Uri doesn't seem to be a playlist");
 		return FALSE;
 	}
 
-	/* No need to keep track of that, it's unreferenced in the callback */
+	/* The same playlist is being downloaded already. This happens when
+	 * the streams from the cache start playback, which then asks for a
+	 * revalidation, while the download is still notifying them.
+	 */
+	if (priv->playlist && gv_playlist_is_downloading(priv->playlist) &&
+	    !g_strcmp0(gv_playlist_get_uri(priv->playlist), priv->uri))
+		return TRUE;
+
+	/* Only the latest download matters */
+	gv_station_cancel_download(self);
+
 	playlist = gv_playlist_new(priv->uri);
+	priv->playlist = playlist;
 	g_signal_connect_object(playlist, "downloaded", G_CALLBACK(on_playlist_downloaded), self, 0);
 	gv_playlist_download(playlist, priv->user_agent ? priv->user_agent : gv_core_user_agent);
 
 	return TRUE;
 }
 
+void
+gv_station_cancel_download(GvStation *self)
+{
+	GvStationPrivate *priv = self->priv;
+
+	if (priv->playlist == NULL)
+		return;
+
+	gv_playlist_cancel(priv->playlist);
+	g_signal_handlers_disconnect_by_data(priv->playlist, self);
+	g_clear_object(&priv->playlist);
+}
+
 gchar *
 gv_station_make_name(GvStation *self, gboolean escape)
 {
@@ -412,6 +502,8 @@ gv_station_finalize(GObject *object)
 	TRACE("%p", object);
 
 	/* Free any allocated resources */
+	gv_station_cancel_download(GV_STATION(object));
+
 	if (priv->stream_uris)
 		g_slist_free_full(priv->stream_uris, g_free);
 
@@ -419,6 +511,7 @@ gv_station_finalize(GObject *object)
 	g_free(priv->name);
 	g_free(priv->uri);
 	g_free(priv->user_agent);
+	g_free(priv->preferred_stream_uri);
 
 	/* Chain up */
 	G_OBJECT_CHAINUP_FINALIZE(gv_station, object);
@@ -35,6 +35,7 @@ G_DECLARE_FINAL_TYPE(GvStation, gv_station, GV, STATION, GInitiallyUnowned)
 GvStation *gv_station_new              (const gchar *name, const gchar *uri);
 gchar     *gv_station_make_name        (GvStation *self, gboolean escape);
 gboolean   gv_station_download_playlist(GvStation *self);
+void       gv_station_cancel_download  (GvStation *self);
 
 /* Property accessors */
 
@@ -45,7 +46,10 @@ const gchar *gv_station_get_uri             (GvStation *self);
 void         gv_station_set_uri             (GvStation *self, const gchar *uri);
 const gchar *gv_station_get_name_or_uri     (GvStation *self);
 GSList      *gv_station_get_stream_uris     (GvStation *self);
+void         gv_station_set_stream_uris     (GvStation *self, GSList *list);
 const gchar *gv_station_get_first_stream_uri(GvStation *self);
+const gchar *gv_station_get_preferred_stream_uri(GvStation *self);
+void         gv_station_set_preferred_stream_uri(GvStation *self, const gchar *uri);
 const gchar *gv_station_get_user_agent      (GvStation *self);
 void         gv_station_set_user_agent      (GvStation *self, const gchar *user_agent);
 guint        gv_station_get_nominal_bitrate (GvStation *self);
@@ -1232,6 +1232,29 @@ on_station_list_station_modified(GvStationList      *station_list G_GNUC_UNUSED,
 	g_free(track_id);
 }
 
+static void
+on_station_list_changed(GvStationList        *station_list G_GNUC_UNUSED,
+                        GvStationListChanges *changes G_GNUC_UNUSED,
+                        GvDbusServerMpris2   *self)
+{
+	GvDbusServer *dbus_server = GV_DBUS_SERVER(self);
+	GvPlayer *player = gv_core_player;
+	GVariantBuilder b;
+	gchar *track_id;
+
+	/* A batch of changes is reported as a whole new track list */
+	track_id = make_track_id(gv_player_get_station(player));
+
+	g_variant_builder_init(&b, G_VARIANT_TYPE("(aoo)"));
+	g_variant_builder_add_value(&b, prop_get_tracks(dbus_server));
+	g_variant_builder_add(&b, "o", track_id);
+
+	gv_dbus_server_emit_signal(dbus_server, DBUS_IFACE_TRACKLIST, "TrackListReplaced",
+	                           g_variant_builder_end(&b));
+
+	g_free(track_id);
+}
+
 /*
  * GvFeature methods
  */
@@ -1267,6 +1290,8 @@ gv_dbus_server_mpris2_enable(GvFeature *feature)
 	                        G_CALLBACK(on_station_list_station_removed), feature, 0);
 	g_signal_connect_object(station_list, "station-modified",
 	                        G_CALLBACK(on_station_list_station_modified), feature, 0);
+	g_signal_connect_object(station_list, "changed",
+	                        G_CALLBACK(on_station_list_changed), feature, 0);
 }
 
 /*
@@ -79,6 +79,11 @@ static const gchar *DBUS_INTROSPECTION =
         "            <arg direction='in'  name='Where'         type='s'/>"
         "            <arg direction='in'  name='AroundStation' type='s'/>"
         "        </method>"
+        "        <method name='Import'>"
+        "            <arg direction='in'  name='Path'          type='s'/>"
+        "            <arg direction='out' name='Imported'      type='u'/>"
+        "            <arg direction='out' name='Duplicates'    type='u'/>"
+        "        </method>"
         "    </interface>"
         "</node>";
 
@@ -417,12 +422,36 @@ method_move(GvDbusServer  *dbus_server G_GNUC_UNUSED,
 	return NULL;
 }
 
+static GVariant *
+method_import(GvDbusServer  *dbus_server G_GNUC_UNUSED,
+              GVariant       *params,
+              GError        **error)
+{
+	GvStationList *station_list = gv_core_station_list;
+	GError *err = NULL;
+	guint n_imported;
+	guint n_duplicates;
+	gchar *path;
+
+	g_variant_get(params, "(&s)", &path);
+
+	if (!gv_station_list_import(station_list, path, &n_imported, &n_duplicates, &err)) {
+		g_set_error(error, G_DBUS_ERROR, G_DBUS_ERROR_FAILED,
+		            "Failed to import '%s': %s", path, err->message);
+		g_error_free(err);
+		return NULL;
+	}
+
+	return g_variant_new("(uu)", n_imported, n_duplicates);
+}
+
 static GvDbusMethod stations_methods[] = {
 	{ "List",   method_list   },
 	{ "Add",    method_add    },
 	{ "Remove", method_remove },
 	{ "Rename", method_rename },
 	{ "Move",   method_move   },
+	{ "Import", method_import },
 	{ NULL,     NULL          }
 };
 
@@ -129,6 +129,27 @@ gv_get_user_config_dir(void)
 	return dir;
 }
 
+const gchar *
+gv_get_user_cache_dir(void)
+{
+	static gchar *dir;
+
+	if (dir == NULL) {
+		const gchar *user_dir;
+		gboolean created;
+
+		user_dir = g_get_user_cache_dir();
+		dir = g_build_filename(user_dir, PACKAGE_NAME, NULL);
+
+		created = g_mkdir_with_parents(dir, S_IRWXU);
+		if (created != 0)
+			WARNING("Failed to make user cache dir '%s': %s",
+			        dir, strerror(errno));
+	}
+
+	return dir;
+}
+
 const gchar *const *
 gv_get_system_config_dirs(void)
 {
@@ -35,6 +35,7 @@ const gchar        *gv_get_current_config_dir(void);
 const gchar        *gv_get_current_data_dir  (void);
 const gchar        *gv_get_user_config_dir   (void);
 const gchar        *gv_get_user_data_dir     (void);
+const gchar        *gv_get_user_cache_dir    (void);
 const gchar *const *gv_get_system_config_dirs(void);
 const gchar *const *gv_get_system_data_dirs  (void);
 
@@ -0,0 +1,155 @@
+/*
+ * Goodvibes Radio Player
+ *
+ * Copyright (C) 2015-2017 Arnaud Rebillout
+ *
+ * SPDX-License-Identifier: GPL-3.0-or-later
+ *
+ * This program is free software: you can redistribute it and/or modify
+ * it under the terms of the GNU General Public License as published by
+ * the Free Software Foundation, either version 3 of the License, or
+ * (at your option) any later version.
+ *
+ * This program is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ * GNU General Public License for more details.
+ *
+ * You should have received a copy of the GNU General Public License
+ * along with this program. If not, see <http://www.gnu.org/licenses/>.
+ */
+
+/*
+ * Playlist parser micro-benchmark.
+ *
+ * Each parser is fed a generated playlist, small (a typical radio
+ * playlist) and large (a station directory export), many times over.
+ *
+ * Execution:
+ *   ./bench-playlist [<n-iterations>]
+ */
+
+#include <stdlib.h>
+#include <string.h>
+
+#include <glib.h>
+
+#include "framework/gv-framework.h"
+#include "core/gv-playlist.h"
+
+#define DEFAULT_ITERATIONS 1000
+
+static gchar *
+make_playlist(GvPlaylistFormat format, guint n_entries)
+{
+	GString *text;
+	guint i;
+
+	text = g_string_new(NULL);
+
+	switch (format) {
+	case GV_PLAYLIST_FORMAT_M3U:
+		g_string_append(text, "#EXTM3U\r\n");
+		for (i = 0; i < n_entries; i++)
+			g_string_append_printf(text,
+			                       "#EXTINF:-1,Station %u\r\n"
+			                       "http://stream-%u.example.com:8000/radio.mp3\r\n",
+			                       i, i);
+		break;
+	case GV_PLAYLIST_FORMAT_PLS:
+		g_string_append(text, "[playlist]\n");
+		for (i = 1; i <= n_entries; i++)
+			g_string_append_printf(text,
+			                       "File%u=http://stream-%u.example.com:8000/radio.mp3\n"
+			                       "Title%u=Station %u\n"
+			                       "Length%u=-1\n",
+			                       i, i, i, i, i);
+		g_string_append_printf(text, "NumberOfEntries=%u\nVersion=2\n", n_entries);
+		break;
+	case GV_PLAYLIST_FORMAT_ASX:
+		g_string_append(text, "<asx version=\"3.0\">\n");
+		for (i = 0; i < n_entries; i++)
+			g_string_append_printf(text,
+			                       "  <entry>\n"
+			                       "    <title>Station %u</title>\n"
+			                       "    <ref href=\"http://stream-%u.example.com:8000/radio.mp3\"/>\n"
+			                       "  </entry>\n",
+			                       i, i);
+		g_string_append(text, "</asx>\n");
+		break;
+	case GV_PLAYLIST_FORMAT_XSPF:
+		g_string_append(text,
+		                "<?xml version=\"1.0\" encoding=\"UTF-8\"?>\n"
+		                "<playlist version=\"1\" xmlns=\"http://xspf.org/ns/0/\">\n"
+		                "  <trackList>\n");
+		for (i = 0; i < n_entries; i++)
+			g_string_append_printf(text,
+			                       "    <track>\n"
+			                       "      <title>Station %u</title>\n"
+			                       "      <location>http://stream-%u.example.com:8000/radio.mp3</location>\n"
+			                       "    </track>\n",
+			                       i, i);
+		g_string_append(text, "  </trackList>\n</playlist>\n");
+		break;
+	default:
+		g_assert_not_reached();
+	}
+
+	return g_string_free(text, FALSE);
+}
+
+static void
+bench(const gchar *what, GvPlaylistFormat format, guint n_entries, guint n_iterations)
+{
+	gchar *text;
+	gsize text_size;
+	gint64 start;
+	gdouble elapsed;
+	guint i;
+
+	text = make_playlist(format, n_entries);
+	text_size = strlen(text);
+
+	start = g_get_monotonic_time();
+	for (i = 0; i < n_iterations; i++) {
+		GSList *streams;
+
+		streams = gv_playlist_parse(format, text, text_size, NULL);
+		if (g_slist_length(streams) != n_entries)
+			g_error("%s playlist: %u streams parsed, %u expected", what,
+			        g_slist_length(streams), n_entries);
+		g_slist_free_full(streams, g_free);
+	}
+	elapsed = (g_get_monotonic_time() - start) / 1000000.0;
+
+	g_print("  %-4s %6u entries  %8zu bytes  %10.3f us/parse  %8.1f MB/s\n",
+	        what, n_entries, text_size, elapsed * 1000000.0 / n_iterations,
+	        elapsed > 0 ? text_size * n_iterations / elapsed / 1000000.0 : 0);
+
+	g_free(text);
+}
+
+int
+main(int argc, char *argv[])
+{
+	static const guint sizes[] = { 4, 10000 };
+	guint n_iterations = DEFAULT_ITERATIONS;
+	guint i;
+
+	log_init("error", TRUE, NULL);
+
+	if (argc > 1)
+		n_iterations = MAX(strtoul(argv[1], NULL, 10), 1);
+
+	for (i = 0; i < G_N_ELEMENTS(sizes); i++) {
+		/* Large playlists are parsed less often */
+		guint n = sizes[i] > 100 ? MAX(n_iterations / 100, 1) : n_iterations;
+
+		bench("m3u", GV_PLAYLIST_FORMAT_M3U, sizes[i], n);
+		bench("pls", GV_PLAYLIST_FORMAT_PLS, sizes[i], n);
+		bench("asx", GV_PLAYLIST_FORMAT_ASX, sizes[i], n);
+		bench("xspf", GV_PLAYLIST_FORMAT_XSPF, sizes[i], n);
+	}
+
+	return EXIT_SUCCESS;
+}
@@ -0,0 +1,170 @@
+/*
+ * Goodvibes Radio Player
+ *
+ * Copyright (C) 2015-2017 Arnaud Rebillout
+ *
+ * SPDX-License-Identifier: GPL-3.0-or-later
+ *
+ * This program is free software: you can redistribute it and/or modify
+ * it under the terms of the GNU General Public License as published by
+ * the Free Software Foundation, either version 3 of the License, or
+ * (at your option) any later version.
+ *
+ * This program is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ * GNU General Public License for more details.
+ *
+ * You should have received a copy of the GNU General Public License
+ * along with this program. If not, see <http://www.gnu.org/licenses/>.
+ */
+
+/*
+ * Station list lookup benchmark.
+ *
+ * Lookups by name, uri and uid, through the indexes of the station list,
+ * compared with a linear walk of the list, at 10k and 100k stations.
+ *
+ * Execution:
+ *   ./bench-station-list [<n-stations>...]
+ */
+
+#include <stdlib.h>
+
+#include <glib.h>
+#include <glib-object.h>
+
+#include "framework/gv-framework.h"
+#include "core/gv-station-list.h"
+
+#define N_LOOKUPS 10000
+
+typedef GvStation *(*FindFunc) (GvStationList *, const gchar *);
+
+typedef const gchar *(*GetFunc) (GvStation *);
+
+/* What the lookups cost without the indexes */
+
+static GvStation *
+find_linear(GvStationList *list, const gchar *string, GetFunc get)
+{
+	GvStationListIter *iter;
+	GvStation *station;
+	GvStation *match = NULL;
+
+	iter = gv_station_list_iter_new(list);
+	while (gv_station_list_iter_loop(iter, &station)) {
+		if (!g_strcmp0(get(station), string)) {
+			match = station;
+			break;
+		}
+	}
+	gv_station_list_iter_free(iter);
+
+	return match;
+}
+
+static void
+bench_lookup(GvStationList *list, GPtrArray *stations, const gchar *what,
+             FindFunc find, GetFunc get)
+{
+	GRand *rand;
+	gint64 start;
+	gdouble indexed, linear;
+	guint n_linear;
+	guint i;
+
+	/* The linear walk is way too slow to do as many lookups */
+	n_linear = MAX(N_LOOKUPS / 100, 1);
+
+	rand = g_rand_new_with_seed(stations->len);
+	start = g_get_monotonic_time();
+	for (i = 0; i < N_LOOKUPS; i++) {
+		GvStation *station = stations->pdata[g_rand_int_range(rand, 0, stations->len)];
+
+		if (find(list, get(station)) != station)
+			g_error("Lookup by %s failed", what);
+	}
+	indexed = (gdouble) (g_get_monotonic_time() - start) / N_LOOKUPS;
+	g_rand_free(rand);
+
+	rand = g_rand_new_with_seed(stations->len);
+	start = g_get_monotonic_time();
+	for (i = 0; i < n_linear; i++) {
+		GvStation *station = stations->pdata[g_rand_int_range(rand, 0, stations->len)];
+
+		if (find_linear(list, get(station), get) != station)
+			g_error("Linear lookup by %s failed", what);
+	}
+	linear = (gdouble) (g_get_monotonic_time() - start) / n_linear;
+	g_rand_free(rand);
+
+	g_print("  by %-4s  indexed: %10.3f us  linear: %10.3f us  (x%.0f)\n",
+	        what, indexed, linear, indexed > 0 ? linear / indexed : 0);
+}
+
+static void
+bench(guint n_stations)
+{
+	GvStationList *list;
+	GPtrArray *stations;
+	gint64 start;
+	guint i;
+
+	if (n_stations == 0)
+		return;
+
+	list = gv_station_list_new();
+	stations = g_ptr_array_sized_new(n_stations);
+
+	start = g_get_monotonic_time();
+	gv_station_list_begin_batch(list);
+	for (i = 0; i < n_stations; i++) {
+		GvStation *station;
+		gchar *name;
+		gchar *uri;
+
+		name = g_strdup_printf("Station %u", i);
+		uri = g_strdup_printf("http://stream-%u.example.com/radio.mp3", i);
+		station = gv_station_new(name, uri);
+		gv_station_list_append(list, station);
+		g_ptr_array_add(stations, station);
+		g_free(name);
+		g_free(uri);
+	}
+	gv_station_list_commit_batch(list);
+
+	g_print("%u stations, appended in %.3f ms\n", n_stations,
+	        (g_get_monotonic_time() - start) / 1000.0);
+
+	bench_lookup(list, stations, "name", gv_station_list_find_by_name,
+	             gv_station_get_name);
+	bench_lookup(list, stations, "uri", gv_station_list_find_by_uri,
+	             gv_station_get_uri);
+	bench_lookup(list, stations, "uid", gv_station_list_find_by_uid,
+	             gv_station_get_uid);
+
+	/* The list is not finalized, that would save it to the user's
+	 * config directory.
+	 */
+	g_ptr_array_free(stations, TRUE);
+}
+
+int
+main(int argc, char *argv[])
+{
+	static const guint default_sizes[] = { 10000, 100000 };
+	int i;
+
+	log_init("warning", TRUE, NULL);
+
+	if (argc < 2) {
+		for (i = 0; i < (int) G_N_ELEMENTS(default_sizes); i++)
+			bench(default_sizes[i]);
+	} else {
+		for (i = 1; i < argc; i++)
+			bench(strtoul(argv[i], NULL, 10));
+	}
+
+	return EXIT_SUCCESS;
+}
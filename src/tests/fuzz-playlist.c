@@ -0,0 +1,137 @@
+/*
+ * Goodvibes Radio Player
+ *
+ * Copyright (C) 2015-2017 Arnaud Rebillout
+ *
+ * SPDX-License-Identifier: GPL-3.0-or-later
+ *
+ * This program is free software: you can redistribute it and/or modify
+ * it under the terms of the GNU General Public License as published by
+ * the Free Software Foundation, either version 3 of the License, or
+ * (at your option) any later version.
+ *
+ * This program is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ * GNU General Public License for more details.
+ *
+ * You should have received a copy of the GNU General Public License
+ * along with this program. If not, see <http://www.gnu.org/licenses/>.
+ */
+
+/*
+ * Playlist parser fuzz target.
+ *
+ * Every input is fed to every parser. By default, it's built as a
+ * standalone program that runs the inputs given on the command line,
+ * or stdin, which is handy to replay a crash.
+ *
+ * With libFuzzer, in a clean build tree, so that the core is built
+ * with the same flags:
+ *   make fuzz-playlist CC=clang \
+ *     CFLAGS="-g -O1 -fsanitize=fuzzer,address -DGV_LIBFUZZER"
+ *   ./fuzz-playlist corpus/
+ *
+ * Standalone:
+ *   ./fuzz-playlist crash-1234 ...
+ *   ./fuzz-playlist < playlist.m3u
+ */
+
+#include <stdlib.h>
+#include <stdint.h>
+#include <stdio.h>
+#include <string.h>
+
+#include <glib.h>
+
+#include "framework/gv-framework.h"
+#include "core/gv-playlist.h"
+
+int LLVMFuzzerTestOneInput(const uint8_t *data, size_t size);
+
+int
+LLVMFuzzerTestOneInput(const uint8_t *data, size_t size)
+{
+	static const GvPlaylistFormat formats[] = {
+		GV_PLAYLIST_FORMAT_M3U,
+		GV_PLAYLIST_FORMAT_PLS,
+		GV_PLAYLIST_FORMAT_ASX,
+		GV_PLAYLIST_FORMAT_XSPF
+	};
+	static gboolean initialized;
+	gchar *text;
+	guint i;
+
+	if (!initialized) {
+		log_init("critical", TRUE, NULL);
+		initialized = TRUE;
+	}
+
+	/* Parsers expect a nul-terminated string, like the one downloaded */
+	text = g_malloc(size + 1);
+	memcpy(text, data, size);
+	text[size] = '\0';
+
+	for (i = 0; i < G_N_ELEMENTS(formats); i++) {
+		GSList *streams, *titles;
+
+		streams = gv_playlist_parse(formats[i], text, size, &titles);
+		g_assert(g_slist_length(streams) == g_slist_length(titles));
+		g_slist_free_full(streams, g_free);
+		g_slist_free_full(titles, g_free);
+	}
+
+	g_free(text);
+
+	return 0;
+}
+
+#ifndef GV_LIBFUZZER
+
+static void
+run_file(const gchar *path)
+{
+	GError *err = NULL;
+	gchar *data;
+	gsize size;
+
+	if (!g_file_get_contents(path, &data, &size, &err)) {
+		g_printerr("%s\n", err->message);
+		g_error_free(err);
+		exit(EXIT_FAILURE);
+	}
+
+	LLVMFuzzerTestOneInput((const uint8_t *) data, size);
+	g_free(data);
+}
+
+static void
+run_stdin(void)
+{
+	GByteArray *data;
+	guint8 buf[4096];
+	size_t n;
+
+	data = g_byte_array_new();
+	while ((n = fread(buf, 1, sizeof buf, stdin)) > 0)
+		g_byte_array_append(data, buf, n);
+
+	LLVMFuzzerTestOneInput(data->data, data->len);
+	g_byte_array_free(data, TRUE);
+}
+
+int
+main(int argc, char *argv[])
+{
+	int i;
+
+	if (argc < 2)
+		run_stdin();
+
+	for (i = 1; i < argc; i++)
+		run_file(argv[i]);
+
+	return EXIT_SUCCESS;
+}
+
+#endif /* GV_LIBFUZZER */
@@ -145,8 +145,33 @@ on_station_list_station_event(GvStationList *station_list G_GNUC_UNUSED,
 	gv_stations_tree_view_populate(self);
 }
 
+static void
+on_station_list_load_progress(GvStationList      *station_list G_GNUC_UNUSED,
+                              guint               n_loaded G_GNUC_UNUSED,
+                              guint               n_stations G_GNUC_UNUSED,
+                              GvStationsTreeView *self)
+{
+	GtkTreeModel *tree_model = gtk_tree_view_get_model(GTK_TREE_VIEW(self));
+
+	/* Show the first stations asap, the whole list is shown once loaded */
+	if (gtk_tree_model_iter_n_children(tree_model, NULL) > 1)
+		return;
+
+	gv_stations_tree_view_populate(self);
+}
+
+static void
+on_station_list_changed(GvStationList        *station_list G_GNUC_UNUSED,
+                        GvStationListChanges *changes G_GNUC_UNUSED,
+                        GvStationsTreeView   *self)
+{
+	gv_stations_tree_view_populate(self);
+}
+
 static GSignalHandler station_list_handlers[] = {
 	{ "loaded",           G_CALLBACK(on_station_list_loaded)        },
+	{ "load-progress",    G_CALLBACK(on_station_list_load_progress) },
+	{ "changed",          G_CALLBACK(on_station_list_changed)       },
 	{ "station-added",    G_CALLBACK(on_station_list_station_event) },
 	{ "station-removed",  G_CALLBACK(on_station_list_station_event) },
 	{ "station-modified", G_CALLBACK(on_station_list_station_event) },